@@ -0,0 +1,328 @@
+#include<stdio.h>
+#include<stdlib.h>
+#include<string.h>
+#include<stdint.h>
+#include<errno.h>
+#include<dirent.h>
+#include<unistd.h>
+#include<utime.h>
+#include<signal.h>
+#include<sys/stat.h>
+#include "ecosystem.h"
+
+/* Content-addressed result cache. A world is keyed by a hash of the header
+   parameters that drive the simulation (everything but N_GEN) and of its initial
+   objects, so runs of the same world with any N_GEN share entries. Each entry is
+   one file <dir>/<key>-<gen>.snap holding the world after gen generations: one is
+   stored at every power of two and one at the end of the run. A run resumes from
+   the latest cached generation <= N_GEN. Files are written to a temporary name and
+   renamed, so concurrent runs never see half a snapshot, and the least recently
+   used files are evicted once the directory grows past its size limit. */
+
+#define SNAP_MAGIC "ECOSNAP1"
+#define SNAP_NAME "%016llx-%010d.snap"
+
+typedef struct snap_header_ {
+  char magic[8];
+  uint64_t key;
+  int32_t gen_proc_rabbits;
+  int32_t gen_proc_foxes;
+  int32_t gen_food_foxes;
+  int32_t R;
+  int32_t C;
+  int32_t gen;
+  int32_t count;
+  int32_t pad;
+}snap_header;
+
+typedef struct snap_cell_ {
+  int32_t cell;
+  int32_t num_gen;
+  int32_t num_food;
+  char type;
+  char pad[3];
+}snap_cell;
+
+typedef struct cache_ {
+  char *dir;
+  long long max_bytes;
+  unsigned long long key;
+  long hits;
+  long stored;
+  long evicted;
+}cache;
+
+typedef struct cache_file_ {
+  char name[64];
+  long long size;
+  time_t mtime;
+}cache_file;
+
+/* Key of the initial world: the grid hash with the parameters mixed in */
+static unsigned long long world_key(const sim *s) {
+  unsigned long long h = world_hash(s);
+  int v[5] = {s->gen_proc_rabbits, s->gen_proc_foxes, s->gen_food_foxes, s->R, s->C}, k;
+  for(k = 0; k < 5; k++) {
+    h ^= (unsigned int)v[k];
+    h *= 1099511628211ULL;
+  }
+  return h;
+}
+
+static void entry_path(const cache *c, int gen, char *path, size_t len) {
+  snprintf(path, len, "%s/" SNAP_NAME, c->dir, c->key, gen);
+}
+
+/* Opens (creating it if needed) the cache directory for the world in s, which
+   must already hold its initial objects */
+int open_cache(sim *s, const char *dir, long long max_bytes) {
+  cache *c;
+  if(mkdir(dir, 0777) != 0 && errno != EEXIST)
+    return -1;
+  c = (cache *)calloc(1, sizeof(cache));
+  c->dir = strdup(dir);
+  c->max_bytes = max_bytes;
+  c->key = world_key(s);
+  s->cache = c;
+  return 0;
+}
+
+/* Writes the current world as the entry for s->current_gen, unless it is cached
+   already. The cells are counted first and then streamed to the file, so storing
+   needs no buffer beyond stdio's */
+static void store_snapshot(sim *s) {
+  cache *c = s->cache;
+  char path[4096], tmp[4160];
+  snap_header h;
+  snap_cell cell;
+  FILE *f;
+  int x, y, n = 0, ok;
+
+  entry_path(c, s->current_gen, path, sizeof(path));
+  if(access(path, F_OK) == 0)
+    return;
+
+  for(x = 0; x < s->R; x++)
+    for(y = 0; y < s->C; y++)
+      if(CELL(s, s->world, x, y).type != ' ')
+        n++;
+
+  memset(&h, 0, sizeof(h));
+  memcpy(h.magic, SNAP_MAGIC, sizeof(h.magic));
+  h.key = c->key;
+  h.gen_proc_rabbits = s->gen_proc_rabbits;
+  h.gen_proc_foxes = s->gen_proc_foxes;
+  h.gen_food_foxes = s->gen_food_foxes;
+  h.R = s->R;
+  h.C = s->C;
+  h.gen = s->current_gen;
+  h.count = n;
+
+  snprintf(tmp, sizeof(tmp), "%s.tmp.%d", path, (int)getpid());
+  f = fopen(tmp, "wb");
+  if(!f)
+    return;
+  ok = fwrite(&h, sizeof(h), 1, f) == 1;
+  memset(&cell, 0, sizeof(cell));
+  for(x = 0; ok && x < s->R; x++)
+    for(y = 0; ok && y < s->C; y++) {
+      const object *o = &CELL(s, s->world, x, y);
+      if(o->type == ' ')
+        continue;
+      cell.cell = x * s->C + y;
+      cell.num_gen = o->num_gen;
+      cell.num_food = o->num_food;
+      cell.type = o->type;
+      ok = fwrite(&cell, sizeof(cell), 1, f) == 1;
+    }
+  if(fclose(f) == 0 && ok && rename(tmp, path) == 0)
+    c->stored++;
+  else
+    unlink(tmp);
+}
+
+/* Replaces the world with the entry for gen. The file is validated before the
+   world is touched, so a bad entry leaves s as it was */
+static int load_snapshot(sim *s, int gen) {
+  cache *c = s->cache;
+  char path[4096];
+  snap_header h;
+  snap_cell *cells;
+  FILE *f;
+  int x, y, k;
+
+  entry_path(c, gen, path, sizeof(path));
+  f = fopen(path, "rb");
+  if(!f)
+    return -1;
+  if(fread(&h, sizeof(h), 1, f) != 1 || memcmp(h.magic, SNAP_MAGIC, sizeof(h.magic)) != 0 ||
+     h.key != c->key || h.gen != gen || h.R != s->R || h.C != s->C ||
+     h.gen_proc_rabbits != s->gen_proc_rabbits || h.gen_proc_foxes != s->gen_proc_foxes ||
+     h.gen_food_foxes != s->gen_food_foxes || h.count < 0 || h.count > s->R * s->C) {
+    fclose(f);
+    return -1;
+  }
+  cells = (snap_cell *)malloc((size_t)(h.count > 0 ? h.count : 1) * sizeof(snap_cell));
+  if(fread(cells, sizeof(snap_cell), h.count, f) != (size_t)h.count) {
+    free(cells);
+    fclose(f);
+    return -1;
+  }
+  fclose(f);
+  for(k = 0; k < h.count; k++)
+    if(cells[k].cell < 0 || cells[k].cell >= s->R * s->C) {
+      free(cells);
+      return -1;
+    }
+
+  for(x = 0; x < s->R; x++)
+    for(y = 0; y < s->C; y++) {
+      CELL(s, s->world, x, y).type = ' ';
+      CELL(s, s->world, x, y).num_gen = 0;
+      CELL(s, s->world, x, y).num_food = 0;
+    }
+  for(k = 0; k < h.count; k++) {
+    object *o = &CELL(s, s->world, cells[k].cell / s->C, cells[k].cell % s->C);
+    o->type = cells[k].type;
+    o->num_gen = cells[k].num_gen;
+    o->num_food = cells[k].num_food;
+  }
+  free(cells);
+  s->current_gen = gen;
+  // Marca a entrada como usada, a expulsão é por ordem de último uso
+  utime(path, NULL);
+  c->hits++;
+  return 0;
+}
+
+/* Moves s to the latest cached generation <= n_gen, if there is one */
+static void resume(sim *s) {
+  cache *c = s->cache;
+  DIR *d = opendir(c->dir);
+  struct dirent *e;
+  char path[4096];
+  int *gens = NULL, n = 0, cap = 0, i, j;
+
+  if(!d)
+    return;
+  while((e = readdir(d)) != NULL) {
+    unsigned long long key;
+    int gen;
+    char end;
+    if(sscanf(e->d_name, "%16llx-%d.snap%c", &key, &gen, &end) != 2 || key != c->key ||
+       gen <= s->current_gen || gen > s->n_gen)
+      continue;
+    if(n == cap) {
+      cap = cap ? 2 * cap : 16;
+      gens = (int *)realloc(gens, cap * sizeof(int));
+    }
+    gens[n++] = gen;
+  }
+  closedir(d);
+
+  // Da geração mais alta para a mais baixa, até uma entrada válida
+  for(i = 0; i < n; i++) {
+    int best = i;
+    for(j = i + 1; j < n; j++)
+      if(gens[j] > gens[best])
+        best = j;
+    j = gens[i];
+    gens[i] = gens[best];
+    gens[best] = j;
+    if(load_snapshot(s, gens[i]) == 0)
+      break;
+    // Entrada ilegível: apaga-a para esta corrida a voltar a escrever
+    entry_path(c, gens[i], path, sizeof(path));
+    unlink(path);
+  }
+  free(gens);
+}
+
+static int by_mtime(const void *a, const void *b) {
+  const cache_file *fa = (const cache_file *)a, *fb = (const cache_file *)b;
+  if(fa->mtime != fb->mtime)
+    return fa->mtime < fb->mtime ? -1 : 1;
+  return strcmp(fa->name, fb->name);
+}
+
+/* Deletes the least recently used entries until the cache fits in max_bytes.
+   Temporary files count too; those of runs that no longer exist are removed
+   straight away, since nobody will ever rename them */
+static void evict(cache *c) {
+  DIR *d = opendir(c->dir);
+  struct dirent *e;
+  cache_file *files = NULL;
+  long long total = 0;
+  int n = 0, cap = 0, i;
+  char path[4096];
+
+  if(!d)
+    return;
+  while((e = readdir(d)) != NULL) {
+    unsigned long long key;
+    int gen, pid, fields;
+    char end;
+    struct stat st;
+    fields = sscanf(e->d_name, "%16llx-%d.snap.tmp.%d%c", &key, &gen, &pid, &end);
+    if((fields != 3 && sscanf(e->d_name, "%16llx-%d.snap%c", &key, &gen, &end) != 2) ||
+       strlen(e->d_name) >= sizeof(files[0].name))
+      continue;
+    snprintf(path, sizeof(path), "%s/%s", c->dir, e->d_name);
+    if(fields == 3 && pid != (int)getpid() && kill(pid, 0) != 0 && errno == ESRCH) {
+      if(unlink(path) == 0)
+        c->evicted++;
+      continue;
+    }
+    if(stat(path, &st) != 0)
+      continue;
+    if(n == cap) {
+      cap = cap ? 2 * cap : 64;
+      files = (cache_file *)realloc(files, cap * sizeof(cache_file));
+    }
+    strcpy(files[n].name, e->d_name);
+    files[n].size = st.st_size;
+    files[n].mtime = st.st_mtime;
+    total += st.st_size;
+    n++;
+  }
+  closedir(d);
+
+  qsort(files, n, sizeof(cache_file), by_mtime);
+  for(i = 0; i < n && total > c->max_bytes; i++) {
+    snprintf(path, sizeof(path), "%s/%s", c->dir, files[i].name);
+    if(unlink(path) == 0) {
+      total -= files[i].size;
+      c->evicted++;
+    }
+  }
+  free(files);
+}
+
+/* Runs s to n_gen through the cache: resumes from the latest cached generation,
+   then stores the world at every power of two and at n_gen. Resuming skips
+   generations, so it is only done when no per-generation output is attached */
+void cache_run(sim *s) {
+  if(!s->stats_out && !s->recorder)
+    resume(s);
+  while(s->current_gen < s->n_gen) {
+    long long next = 1;
+    while(next <= s->current_gen)
+      next <<= 1;
+    if(next > s->n_gen)
+      next = s->n_gen;
+    sim_run(s, (int)next - s->current_gen);
+    store_snapshot(s);
+  }
+  evict(s->cache);
+}
+
+void close_cache(sim *s) {
+  cache *c = s->cache;
+  if(!c)
+    return;
+  fprintf(stderr, "cache: key %016llx, %ld hit, %ld stored, %ld evicted\n",
+          c->key, c->hits, c->stored, c->evicted);
+  free(c->dir);
+  free(c);
+  s->cache = NULL;
+}
@@ -0,0 +1,234 @@
+#ifndef ECOSYSTEM_H
+#define ECOSYSTEM_H
+
+#include<stdio.h>
+#include<omp.h>
+
+typedef struct object_{
+    char type;
+    int num_gen;
+    int num_food;
+}object;
+
+typedef struct pos_ {
+  int x,y;
+}pos;
+
+struct backend_;
+struct recorder_;
+struct cache_;
+struct profile_;
+
+/* A move the kernel left for later because it lands outside the worker's rows */
+typedef struct deferred_move_ {
+  object current;
+  int x, y;
+  int nx, ny;
+}deferred_move;
+
+/* Per-thread state of the move kernels: event counters, while recording the move
+   of every creature they processed, and for backends that give each thread its
+   own rows the moves that leave them. Padded to cache lines so threads never
+   share one */
+typedef struct worker_ {
+  long rabbits_placed;
+  long rabbit_births;
+  long rabbit_conflicts;
+  long foxes_placed;
+  long fox_births;
+  long fox_conflicts;
+  long predations;
+  long starvations;
+  long long *moves;
+  int n_moves;
+  int cap_moves;
+  // Linhas [row_lo, row_hi) onde o worker pode escrever, sem limite se row_hi == 0
+  int row_lo;
+  int row_hi;
+  deferred_move *deferred;
+  int n_deferred;
+  int cap_deferred;
+} __attribute__((aligned(64))) worker;
+
+/* Population dynamics of one generation, reduced from the thread counters */
+typedef struct gen_stats_ {
+  int gen;
+  int rabbits;
+  int foxes;
+  int rabbit_births;
+  int fox_births;
+  int starvations;
+  int predations;
+  int rabbit_conflicts;
+  int fox_conflicts;
+}gen_stats;
+
+/* One simulated world: the input header, both grids and the backend driving them */
+typedef struct sim_ {
+  int gen_proc_rabbits;
+  int gen_proc_foxes;
+  int gen_food_foxes;
+  int n_gen;
+  int R;
+  int C;
+  int N;
+  int current_gen;
+  // Layout das grelhas, ver CELL()
+  int n_bands;
+  int band_slots;
+  int n_slots;
+  int slot_cells;
+  int *slot_order;
+  object **world;
+  object **new_world;
+  // LOCK MATRIX - one lock per cell, same layout as the grids, only allocated by backends that need it
+  omp_lock_t **cell_locks;
+  const struct backend_ *backend;
+  // Estado privado do backend
+  void *priv;
+  worker *workers;
+  int n_workers;
+  gen_stats stats;
+  FILE *stats_out;
+  int stats_binary;
+  struct recorder_ *recorder;
+  struct cache_ *cache;
+  struct profile_ *profile;
+}sim;
+
+/* Grid layout. A grid is a table of pointers to slots of contiguous cells, all in
+   one block in slot_order. By default a slot is a row. Built with -DLAYOUT_TILED a
+   slot is a TILE x TILE tile and the tiles follow a Z-order (Morton) curve, so the
+   north and south neighbours of a cell are usually in the same tile and nearby
+   tiles share pages. A band is the run of band_slots slots that covers BAND_ROWS
+   whole rows. Cells, and their locks, are addressed through CELL(), or as cell i of
+   slot t (g[t][i]) by code that walks whole slots. */
+#ifdef LAYOUT_TILED
+#define TILE_SHIFT 3
+#define TILE (1 << TILE_SHIFT)
+#define BAND_ROWS TILE
+#define SLOT_OF(s, x, y) (((x) >> TILE_SHIFT) * (s)->band_slots + ((y) >> TILE_SHIFT))
+#define SLOT_CELL(x, y) ((((x) & (TILE - 1)) << TILE_SHIFT) | ((y) & (TILE - 1)))
+// Linha e coluna da célula i de um slot, relativas ao canto do slot
+#define SLOT_X(i) ((i) >> TILE_SHIFT)
+#define SLOT_Y(i) ((i) & (TILE - 1))
+#else
+#define BAND_ROWS 1
+#define SLOT_OF(s, x, y) (x)
+#define SLOT_CELL(x, y) (y)
+#define SLOT_X(i) 0
+#define SLOT_Y(i) (i)
+#endif
+#define CELL(s, g, x, y) ((g)[SLOT_OF(s, x, y)][SLOT_CELL(x, y)])
+
+/* Cells covered by slot t: rows x0..x1-1, columns y0..y1-1 */
+static inline void slot_bounds(const sim *s, int t, int *x0, int *x1, int *y0, int *y1) {
+#ifdef LAYOUT_TILED
+  *x0 = (t / s->band_slots) << TILE_SHIFT;
+  *y0 = (t % s->band_slots) << TILE_SHIFT;
+  *x1 = *x0 + TILE < s->R ? *x0 + TILE : s->R;
+  *y1 = *y0 + TILE < s->C ? *y0 + TILE : s->C;
+#else
+  *x0 = t;
+  *x1 = t + 1;
+  *y0 = 0;
+  *y1 = s->C;
+#endif
+}
+
+/* Backend interface: every backend advances the same sim through the same two phases.
+   After each phase sim->world holds the current state of the grid.
+   Backends that overlap phases instead provide run(), which advances n generations
+   starting at sim->current_gen and leaves current_gen for the caller to update.
+   Single-buffer backends update sim->world in place and never get a new_world. */
+typedef struct backend_ {
+  const char *name;
+  void (*init)(sim *s);
+  void (*destroy)(sim *s);
+  void (*rabbit_phase)(sim *s);
+  void (*fox_phase)(sim *s);
+  void (*run)(sim *s, int n);
+  int single_buffer;
+}backend;
+
+extern const backend sequential_backend;
+extern const backend omp_locks_backend;
+extern const backend wavefront_backend;
+extern const backend inplace_backend;
+
+/* parallel.c */
+void init_locks(sim *s);
+void destroy_locks(sim *s);
+
+/* world.c */
+const backend *find_backend(const char *name);
+int read_header(sim *s, FILE *in);
+void alloc_world(sim *s);
+object **alloc_grid(const sim *s);
+void free_grid(const sim *s, object **g);
+void free_world(sim *s);
+void clone_world(sim *dst, const sim *src);
+void init_world(sim *s);
+int fill_world(sim *s, FILE *in);
+void swap_worlds(sim *s);
+void print_world(const sim *s);
+void output(const sim *s);
+unsigned long long world_hash(const sim *s);
+void move_slot(sim *s, worker *w, object **from, object **to, int gen, int t, char kind);
+void carry_rabbits(sim *s, object **from, object **to, int t);
+void clear_slot(sim *s, object **g, int t);
+void rabbit_phase(sim *s);
+void fox_phase(sim *s);
+void sim_start(sim *s, const backend *b);
+void sim_step(sim *s);
+void sim_run(sim *s, int n);
+void sim_end(sim *s);
+
+/* stats.c */
+void alloc_workers(sim *s);
+void free_workers(sim *s);
+void clear_workers(sim *s);
+void end_generation(sim *s);
+int open_stats(sim *s, const char *path);
+void close_stats(sim *s);
+
+/* kernels.c */
+/* Where a kernel call sent its creature, as logged for the recorder */
+enum { MOVE_STAY, MOVE_NORTH, MOVE_EAST, MOVE_SOUTH, MOVE_WEST, MOVE_STARVED };
+extern const int move_dx[MOVE_STARVED], move_dy[MOVE_STARVED];
+void move_rabbit(sim *s, worker *w, object **world, object **new_world, int gen, int x, int y, int t, int i);
+void move_fox(sim *s, worker *w, object **world, object **new_world, int gen, int x, int y, int t, int i);
+void place_rabbit(sim *s, worker *w, object **new_world, object current, int x, int y, int nx, int ny);
+void place_fox(sim *s, worker *w, object **new_world, object current, int x, int y, int nx, int ny);
+
+/* recorder.c */
+int open_recorder(sim *s, const char *prefix, int keyframe_interval);
+void record_generation(sim *s);
+int close_recorder(sim *s);
+int replay(sim *s, const char *prefix, int gen);
+
+/* cache.c */
+int open_cache(sim *s, const char *dir, long long max_bytes);
+void cache_run(sim *s);
+void close_cache(sim *s);
+
+/* profile.c */
+/* Parts of the generation loop the profile charges counters to. Each half of a
+   generation is split into its moves and the sweep that readies the grids after
+   them (carrying the rabbits over, resetting the fox grid); the backends mark
+   these themselves. PHASE_RUN is a whole batch of a backend that overlaps phases */
+enum { PHASE_RABBIT_MOVE, PHASE_RABBIT_CARRY, PHASE_FOX_MOVE, PHASE_FOX_RESET,
+       PHASE_REDUCE, PHASE_RECORD, PHASE_RUN, N_PHASES };
+void open_profile(sim *s);
+void profile_begin(sim *s);
+void profile_end(sim *s, int phase);
+void close_profile(sim *s);
+
+/* server.c */
+int serve(const char *path, const backend *b);
+int client(const char *path);
+
+/* verify.c */
+int verify(sim *ref, sim *cand);
+
+#endif
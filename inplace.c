@@ -0,0 +1,198 @@
+#include<stdio.h>
+#include<stdlib.h>
+#include<string.h>
+#include<omp.h>
+#include "ecosystem.h"
+
+/* Single-buffer backend: updates sim->world in place instead of swapping two grids.
+   A creature on band b only reads bands b-1..b+1 of the old world and only writes
+   bands b-1..b+1 of the new one, so bands are processed in order and the new bands
+   b-1, b and b+1 live in a ring of three band buffers. Once band b is done, new band
+   b-1 is final and nobody will read old band b-1 again, so it is written back over
+   it. A band is a row, or a row of tiles in the tiled layout.
+   Each thread sweeps its own stripe of bands with its own ring. The new first and
+   last bands of a stripe are kept apart until the end of the phase, so the old ones
+   stay in the world for the neighbouring stripes to read. A kernel whose creature
+   lands in another stripe queues the placement on its worker instead; after a
+   barrier the queues are placed and the boundary bands written back. Memory is one
+   grid plus five bands per thread, and every kernel call sees exactly what it would
+   see in the double-buffered swap_worlds() flow. */
+
+// Bandas mínimas por faixa, para a primeira e a última serem bandas diferentes
+#define STRIPE_MIN_BANDS 2
+
+typedef struct stripe_ {
+  int b0;
+  int b1;          // bandas [b0, b1)
+  object *ring[3];
+  // Primeira e última bandas novas, abertas até ao fim da fase
+  object *head;
+  object *tail;
+}stripe;
+
+typedef struct inplace_ {
+  stripe *stripes;
+  int n_stripes;
+  // Tabela de slots para os kernels: cada faixa preenche as suas bandas abertas
+  object **window;
+}inplace;
+
+static object *band_buffer(const stripe *st, int b) {
+  if(b == st->b0)
+    return st->head;
+  if(b == st->b1 - 1)
+    return st->tail;
+  return st->ring[b % 3];
+}
+
+/* Starts new band b as the phase's reset + copy would: rocks and the creatures of
+   the other kind stay, everything else becomes empty */
+static void open_band(sim *s, inplace *ip, const stripe *st, int b, char moving) {
+  int i,j;
+  for(j = 0; j < s->band_slots; j++) {
+    int t = b * s->band_slots + j;
+    const object *o = s->world[t];
+    object *n = ip->window[t] = band_buffer(st, b) + (size_t)j * s->slot_cells;
+    // O slot inteiro, para as células fora do mundo voltarem vazias com close_band()
+    for(i = 0; i < s->slot_cells; i++) {
+      if(o[i].type == '*' || (o[i].type != ' ' && o[i].type != moving))
+        n[i] = o[i];
+      else {
+        n[i].type = ' ';
+        n[i].num_gen = 0;
+        n[i].num_food = 0;
+      }
+    }
+  }
+}
+
+static void close_band(sim *s, inplace *ip, int b) {
+  int j;
+  for(j = 0; j < s->band_slots; j++) {
+    int t = b * s->band_slots + j;
+    memcpy(s->world[t], ip->window[t], s->slot_cells * sizeof(object));
+  }
+}
+
+/* Moves every creature of one kind in a stripe, band by band. Only the interior
+   bands are written back; the first and last wait for the other stripes */
+static void sweep_stripe(sim *s, inplace *ip, const stripe *st, worker *w, char moving) {
+  int b,t;
+
+  w->row_lo = st->b0 * BAND_ROWS;
+  w->row_hi = st->b1 * BAND_ROWS < s->R ? st->b1 * BAND_ROWS : s->R;
+  open_band(s, ip, st, st->b0, moving);
+  if(st->b0 + 1 < st->b1)
+    open_band(s, ip, st, st->b0 + 1, moving);
+  for(b = st->b0; b < st->b1; b++) {
+    for(t = b * s->band_slots; t < (b + 1) * s->band_slots; t++)
+      move_slot(s, w, s->world, ip->window, s->current_gen, t, moving);
+    if(b - 1 > st->b0)
+      close_band(s, ip, b - 1);
+    if(b + 2 < st->b1)
+      open_band(s, ip, st, b + 2, moving);
+  }
+}
+
+/* Places the moves the workers queued across stripes. Each one lands on a first
+   or last band, and so does the child a breeding creature leaves behind */
+static void place_deferred(sim *s, inplace *ip) {
+  int i,k;
+  for(i = 0; i < s->n_workers; i++) {
+    worker *w = &s->workers[i];
+    for(k = 0; k < w->n_deferred; k++) {
+      deferred_move *d = &w->deferred[k];
+      if(d->current.type == 'R')
+        place_rabbit(s, w, ip->window, d->current, d->x, d->y, d->nx, d->ny);
+      else
+        place_fox(s, w, ip->window, d->current, d->x, d->y, d->nx, d->ny);
+    }
+    w->n_deferred = 0;
+  }
+}
+
+/* Moves every creature of one kind, one stripe per thread. The profile charges
+   the moves to move_phase and the write-back of the stripes' first and last bands
+   to done_phase */
+static void sweep(sim *s, char moving, int move_phase, int done_phase) {
+  inplace *ip = (inplace *)s->priv;
+
+  profile_begin(s);
+  #pragma omp parallel num_threads(ip->n_stripes)
+  {
+    worker *w = &s->workers[omp_get_thread_num()];
+    int i;
+    // Uma equipa mais pequena do que o pedido fica com várias faixas por thread
+    for(i = omp_get_thread_num(); i < ip->n_stripes; i += omp_get_num_threads())
+      sweep_stripe(s, ip, &ip->stripes[i], w, moving);
+    #pragma omp barrier
+    #pragma omp single
+    {
+      place_deferred(s, ip);
+      profile_end(s, move_phase);
+      profile_begin(s);
+    }
+    for(i = omp_get_thread_num(); i < ip->n_stripes; i += omp_get_num_threads()) {
+      close_band(s, ip, ip->stripes[i].b0);
+      if(ip->stripes[i].b1 - 1 != ip->stripes[i].b0)
+        close_band(s, ip, ip->stripes[i].b1 - 1);
+    }
+  }
+  profile_end(s, done_phase);
+}
+
+static void rabbit_sweep(sim *s) {
+  sweep(s, 'R', PHASE_RABBIT_MOVE, PHASE_RABBIT_CARRY);
+}
+
+static void fox_sweep(sim *s) {
+  sweep(s, 'F', PHASE_FOX_MOVE, PHASE_FOX_RESET);
+}
+
+static void init(sim *s) {
+  inplace *ip = (inplace *)malloc(sizeof(inplace));
+  size_t band = (size_t)s->band_slots * s->slot_cells * sizeof(object);
+  int i, j;
+  ip->n_stripes = s->n_workers < s->n_bands / STRIPE_MIN_BANDS ? s->n_workers : s->n_bands / STRIPE_MIN_BANDS;
+  if(ip->n_stripes < 1)
+    ip->n_stripes = 1;
+  ip->stripes = (stripe *)malloc(ip->n_stripes * sizeof(stripe));
+  for(i = 0; i < ip->n_stripes; i++) {
+    stripe *st = &ip->stripes[i];
+    st->b0 = (int)((long long)s->n_bands * i / ip->n_stripes);
+    st->b1 = (int)((long long)s->n_bands * (i + 1) / ip->n_stripes);
+    for(j = 0; j < 3; j++)
+      st->ring[j] = (object *)malloc(band);
+    st->head = (object *)malloc(band);
+    st->tail = (object *)malloc(band);
+  }
+  ip->window = (object **)calloc(s->n_slots, sizeof(object *));
+  s->priv = ip;
+}
+
+static void destroy(sim *s) {
+  inplace *ip = (inplace *)s->priv;
+  int i, j;
+  for(i = 0; i < ip->n_stripes; i++) {
+    for(j = 0; j < 3; j++)
+      free(ip->stripes[i].ring[j]);
+    free(ip->stripes[i].head);
+    free(ip->stripes[i].tail);
+  }
+  for(i = 0; i < s->n_workers; i++)
+    s->workers[i].row_lo = s->workers[i].row_hi = 0;
+  free(ip->stripes);
+  free(ip->window);
+  free(ip);
+  s->priv = NULL;
+}
+
+const backend inplace_backend = {
+  "inplace",
+  init,
+  destroy,
+  rabbit_sweep,
+  fox_sweep,
+  NULL,
+  1,
+};
@@ -0,0 +1,253 @@
+#include<stdlib.h>
+#include<omp.h>
+#include "ecosystem.h"
+
+// Deslocamento de cada código de movimento (MOVE_STAY..MOVE_WEST)
+const int move_dx[MOVE_STARVED] = {0, -1, 0, 1, 0};
+const int move_dy[MOVE_STARVED] = {0, 0, 1, 0, -1};
+
+/* Locks cell i of slot t of the new world when the backend runs the kernels concurrently */
+static inline void lock_cell(sim *s, int t, int i) {
+  if(s->cell_locks)
+    omp_set_lock(&s->cell_locks[t][i]);
+}
+
+static inline void unlock_cell(sim *s, int t, int i) {
+  if(s->cell_locks)
+    omp_unset_lock(&s->cell_locks[t][i]);
+}
+
+/* Logs where the creature on (x,y) went, only while recording: one entry per
+   kernel call, its cell times 8 plus the move code */
+static inline void log_move(sim *s, worker *w, int x, int y, int code) {
+  if(!w->moves)
+    return;
+  if(w->n_moves == w->cap_moves) {
+    w->cap_moves *= 2;
+    w->moves = (long long *)realloc(w->moves, w->cap_moves * sizeof(long long));
+  }
+  w->moves[w->n_moves++] = ((long long)x * s->C + y) << 3 | code;
+}
+
+/* Queues the placement of a creature moving to (nx,ny) when that row belongs to
+   another worker; returns 0 if the kernel may place it itself */
+static inline int defer_move(worker *w, const object *current, int x, int y, int nx, int ny) {
+  deferred_move *d;
+  if(!w->row_hi || (nx >= w->row_lo && nx < w->row_hi))
+    return 0;
+  if(w->n_deferred == w->cap_deferred) {
+    w->cap_deferred = w->cap_deferred ? 2 * w->cap_deferred : 256;
+    w->deferred = (deferred_move *)realloc(w->deferred, w->cap_deferred * sizeof(deferred_move));
+  }
+  d = &w->deferred[w->n_deferred++];
+  d->current = *current;
+  d->x = x;
+  d->y = y;
+  d->nx = nx;
+  d->ny = ny;
+  return 1;
+}
+
+/* Finds the cells next to cell i of slot t, which is (x,y): cell ni[d] of slot
+   nt[d] for every move code d up to MOVE_WEST, with nt[d] -1 where it falls
+   outside the world. Inside a tile they are i -+ TILE and i -+ 1; only the steps
+   across a tile edge (every step north or south, in the row-major layout) change
+   slot */
+static inline void neighbours(const sim *s, int x, int y, int t, int i, int nt[MOVE_STARVED], int ni[MOVE_STARVED]) {
+#ifdef LAYOUT_TILED
+  int tx = x & (TILE - 1), ty = y & (TILE - 1);
+  nt[MOVE_NORTH] = x == 0 ? -1 : tx ? t : t - s->band_slots;
+  ni[MOVE_NORTH] = tx ? i - TILE : i + (TILE - 1) * TILE;
+  nt[MOVE_EAST] = y == s->C - 1 ? -1 : ty != TILE - 1 ? t : t + 1;
+  ni[MOVE_EAST] = ty != TILE - 1 ? i + 1 : i - (TILE - 1);
+  nt[MOVE_SOUTH] = x == s->R - 1 ? -1 : tx != TILE - 1 ? t : t + s->band_slots;
+  ni[MOVE_SOUTH] = tx != TILE - 1 ? i + TILE : i - (TILE - 1) * TILE;
+  nt[MOVE_WEST] = y == 0 ? -1 : ty ? t : t - 1;
+  ni[MOVE_WEST] = ty ? i - 1 : i + (TILE - 1);
+#else
+  nt[MOVE_NORTH] = x == 0 ? -1 : t - 1;
+  ni[MOVE_NORTH] = i;
+  nt[MOVE_EAST] = y == s->C - 1 ? -1 : t;
+  ni[MOVE_EAST] = i + 1;
+  nt[MOVE_SOUTH] = x == s->R - 1 ? -1 : t + 1;
+  ni[MOVE_SOUTH] = i;
+  nt[MOVE_WEST] = y == 0 ? -1 : t;
+  ni[MOVE_WEST] = i - 1;
+#endif
+  nt[MOVE_STAY] = t;
+  ni[MOVE_STAY] = i;
+}
+
+/* Collects the moves towards neighbours holding type into dirs, returns how many */
+static inline int probe(object **g, const int nt[MOVE_STARVED], const int ni[MOVE_STARVED], char type, int dirs[4]) {
+  int p = 0;
+  //North
+  if(nt[MOVE_NORTH] >= 0 && g[nt[MOVE_NORTH]][ni[MOVE_NORTH]].type == type)
+    dirs[p++] = MOVE_NORTH;
+  //East
+  if(nt[MOVE_EAST] >= 0 && g[nt[MOVE_EAST]][ni[MOVE_EAST]].type == type)
+    dirs[p++] = MOVE_EAST;
+  //South
+  if(nt[MOVE_SOUTH] >= 0 && g[nt[MOVE_SOUTH]][ni[MOVE_SOUTH]].type == type)
+    dirs[p++] = MOVE_SOUTH;
+  //West
+  if(nt[MOVE_WEST] >= 0 && g[nt[MOVE_WEST]][ni[MOVE_WEST]].type == type)
+    dirs[p++] = MOVE_WEST;
+  return p;
+}
+
+/* Puts the rabbit that was on cell i of slot t on cell ni of slot nt of the new
+   world: it breeds if it leaves its cell when due, and the youngest wins when two
+   rabbits meet */
+static void put_rabbit(sim *s, worker *w, object **new_world, object current, int t, int i, int nt, int ni) {
+  object *new;
+  if(nt == t && ni == i) {
+    if(current.num_gen == 0) {
+      current.num_gen = 1;
+    }
+  }
+  else {
+    if(current.num_gen == 0) {
+      // LOCK: Protege a célula atual ao criar filho
+      lock_cell(s, t, i);
+      new = &new_world[t][i];
+      new->type = current.type;
+      new->num_gen = s->gen_proc_rabbits;
+      unlock_cell(s, t, i);
+      w->rabbit_births++;
+
+      current.num_gen = s->gen_proc_rabbits + 1;
+    }
+  }
+
+  new = &new_world[nt][ni];
+
+  // LOCK: Protege a célula de destino de conflitos (múltiplos coelhos tentando mover para mesma célula)
+  lock_cell(s, nt, ni);
+  {
+    if(new->type == 'R'){
+      // Resolve conflito: mantém o coelho mais jovem
+      if(current.num_gen - 1 < new->num_gen)
+        new->num_gen = current.num_gen - 1;
+      w->rabbit_conflicts++;
+    }
+    else {
+      new->type = current.type;
+      new->num_gen = current.num_gen - 1;
+      w->rabbits_placed++;
+    }
+  }
+  unlock_cell(s, nt, ni);
+}
+
+/* Puts the rabbit that was on (x,y) on (nx,ny) of the new world, see put_rabbit() */
+void place_rabbit(sim *s, worker *w, object **new_world, object current, int x, int y, int nx, int ny) {
+  put_rabbit(s, w, new_world, current, SLOT_OF(s, x, y), SLOT_CELL(x, y), SLOT_OF(s, nx, ny), SLOT_CELL(nx, ny));
+}
+
+/* Moves the rabbit on (x,y), cell i of slot t, to an adjacent empty cell or reproduces */
+void move_rabbit(sim *s, worker *w, object **world, object **new_world, int gen, int x, int y, int t, int i) {
+  object current = world[t][i];
+  int nt[MOVE_STARVED], ni[MOVE_STARVED], dirs[4], p, d;
+
+  neighbours(s, x, y, t, i, nt, ni);
+  p = probe(world, nt, ni, ' ', dirs);
+  d = p == 0 ? MOVE_STAY : dirs[(x + y + gen) % p];
+  if(!defer_move(w, &current, x, y, x + move_dx[d], y + move_dy[d]))
+    put_rabbit(s, w, new_world, current, t, i, nt[d], ni[d]);
+  log_move(s, w, x, y, d);
+}
+
+/* Puts the fox that was on cell i of slot t on cell ni of slot nt of the new world:
+   it breeds if it leaves its cell when due, eats a rabbit it lands on, and fox
+   conflicts keep the youngest, then the best fed */
+static void put_fox(sim *s, worker *w, object **new_world, object current, int t, int i, int nt, int ni) {
+  object *new;
+  if(nt == t && ni == i) {
+    if(current.num_gen == 0) {
+      current.num_gen = 1;
+    }
+  }
+  else {
+    if(current.num_gen == 0) {
+      // LOCK: Protege a célula atual ao criar filho raposa
+      lock_cell(s, t, i);
+      new = &new_world[t][i];
+      new->type = current.type;
+      new->num_gen = s->gen_proc_foxes;
+      new->num_food = s->gen_food_foxes;
+      unlock_cell(s, t, i);
+      w->fox_births++;
+
+      current.num_gen = s->gen_proc_foxes + 1;
+    }
+  }
+
+  new = &new_world[nt][ni];
+
+  // LOCK: Protege a célula de destino de conflitos (múltiplas raposas tentando mover para mesma célula)
+  lock_cell(s, nt, ni);
+  {
+    if(new->type == 'F'){
+      // Resolve conflito entre raposas
+      if(current.num_gen - 1 < new->num_gen){
+        new->num_gen = current.num_gen - 1;
+        if(new->num_food != s->gen_food_foxes)
+          new->num_food = current.num_food - 1;
+      }
+      else if(current.num_gen - 1 == new->num_gen)
+        if(current.num_food - 1 > new->num_food) {
+          new->num_food = current.num_food - 1;
+        }
+      w->fox_conflicts++;
+    }
+    else{
+      if(new->type == 'R'){
+        // Comeu um coelho
+        new->num_food = s->gen_food_foxes;
+        w->predations++;
+      }
+      else{
+        // Moveu para célula vazia
+        new->num_food = current.num_food - 1;
+      }
+      new->num_gen = current.num_gen - 1;
+      new->type = 'F';
+      w->foxes_placed++;
+    }
+  }
+  unlock_cell(s, nt, ni);
+}
+
+/* Puts the fox that was on (x,y) on (nx,ny) of the new world, see put_fox() */
+void place_fox(sim *s, worker *w, object **new_world, object current, int x, int y, int nx, int ny) {
+  put_fox(s, w, new_world, current, SLOT_OF(s, x, y), SLOT_CELL(x, y), SLOT_OF(s, nx, ny), SLOT_CELL(nx, ny));
+}
+
+/* Moves the fox on (x,y), cell i of slot t, to hunt a rabbit or to an empty cell,
+   handling reproduction and starvation */
+void move_fox(sim *s, worker *w, object **world, object **new_world, int gen, int x, int y, int t, int i) {
+  object current = world[t][i];
+  int nt[MOVE_STARVED], ni[MOVE_STARVED], dirs[4], p, d;
+
+  neighbours(s, x, y, t, i, nt, ni);
+  // Procura coelhos adjacentes (prioridade)
+  p = probe(world, nt, ni, 'R', dirs);
+
+  if(p == 0){
+    // Morre de fome
+    if(current.num_food == 1) {
+      w->starvations++;
+      log_move(s, w, x, y, MOVE_STARVED);
+      return;
+    }
+
+    // Procura células vazias
+    p = probe(world, nt, ni, ' ', dirs);
+  }
+
+  d = p == 0 ? MOVE_STAY : dirs[(x + y + gen) % p];
+  if(!defer_move(w, &current, x, y, x + move_dx[d], y + move_dy[d]))
+    put_fox(s, w, new_world, current, t, i, nt[d], ni[d]);
+  log_move(s, w, x, y, d);
+}
@@ -0,0 +1,159 @@
+#include<stdio.h>
+#include<stdlib.h>
+#include<string.h>
+#include<unistd.h>
+#include<omp.h>
+#include "ecosystem.h"
+
+#ifndef DEFAULT_BACKEND
+#define DEFAULT_BACKEND "seq"
+#endif
+
+static void usage(const char *prog) {
+  fprintf(stderr,
+          "usage: %s [threads] [-t threads] [-b backend] [-v reference] [-s stats]\n"
+          "          [-r prefix [-k interval]] [-C dir [-M mib]] [-P] < input\n"
+          "       %s -r prefix -p gen\n"
+          "       %s [-t threads] [-b backend] -l socket\n"
+          "       %s -c socket < commands\n"
+          "  -b backend    seq | omp-locks | wavefront | inplace (default " DEFAULT_BACKEND ")\n"
+          "  -v reference  run the reference backend in lockstep and compare after every phase\n"
+          "  -s stats      write per-generation population stats (CSV, binary if it ends in .bin)\n"
+          "  -r prefix     record the trajectory to prefix.traj / prefix.idx\n"
+          "  -k interval   generations between keyframes (default 64)\n"
+          "  -p gen        print generation gen of a recorded trajectory\n"
+          "  -C dir        reuse and store results in a cache directory\n"
+          "  -M mib        cache size limit, least recently used entries go first (default 256)\n"
+          "  -P            profile every phase with hardware counters, report on stderr\n"
+          "  -l socket     keep worlds resident and serve requests on a Unix socket\n"
+          "  -c socket     send the commands read from stdin to a server\n",
+          prog, prog, prog, prog);
+}
+
+/* Main function that initializes the ecosystem simulation and runs it for N_GEN generations */
+int main(int argc, char *argv[]) {
+  const char *backend_name = DEFAULT_BACKEND, *reference_name = NULL, *stats_path = NULL;
+  const char *record_prefix = NULL, *listen_path = NULL, *client_path = NULL, *cache_dir = NULL;
+  long long cache_mib = 256;
+  int keyframe_interval = 64, replay_gen = -1;
+  const backend *b, *ref_b = NULL;
+  int num_threads = omp_get_max_threads();
+  int opt, status = 0, profiling = 0;
+  sim s, ref;
+
+  memset(&s, 0, sizeof(s));
+  while((opt = getopt(argc, argv, "t:b:v:s:r:k:p:l:c:C:M:P")) != -1) {
+    switch(opt) {
+    case 't': num_threads = atoi(optarg); break;
+    case 'b': backend_name = optarg; break;
+    case 'v': reference_name = optarg; break;
+    case 's': stats_path = optarg; break;
+    case 'r': record_prefix = optarg; break;
+    case 'k': keyframe_interval = atoi(optarg); break;
+    case 'p': replay_gen = atoi(optarg); break;
+    case 'l': listen_path = optarg; break;
+    case 'c': client_path = optarg; break;
+    case 'C': cache_dir = optarg; break;
+    case 'M': cache_mib = atoll(optarg); break;
+    case 'P': profiling = 1; break;
+    default: usage(argv[0]); return 2;
+    }
+  }
+  // Número de threads também aceite como argumento posicional (./parallel 8)
+  if(optind < argc)
+    num_threads = atoi(argv[optind]);
+  if(num_threads < 1)
+    num_threads = 1;
+  omp_set_num_threads(num_threads);
+
+  if(client_path)
+    return client(client_path);
+
+  if(replay_gen >= 0) {
+    if(!record_prefix) {
+      usage(argv[0]);
+      return 2;
+    }
+    if(replay(&s, record_prefix, replay_gen) != 0) {
+      fprintf(stderr, "generation %d is not in trajectory '%s'\n", replay_gen, record_prefix);
+      return 1;
+    }
+    print_world(&s);
+    free_world(&s);
+    return 0;
+  }
+
+  b = find_backend(backend_name);
+  if(!b) {
+    fprintf(stderr, "unknown backend '%s'\n", backend_name);
+    return 2;
+  }
+  if(reference_name) {
+    ref_b = find_backend(reference_name);
+    if(!ref_b) {
+      fprintf(stderr, "unknown backend '%s'\n", reference_name);
+      return 2;
+    }
+  }
+
+  if(listen_path)
+    return serve(listen_path, b);
+
+  if(read_header(&s, stdin) != 0) {
+    fprintf(stderr, "invalid input header\n");
+    return 1;
+  }
+  alloc_world(&s);
+  init_world(&s);
+  if(fill_world(&s, stdin) != 0) {
+    fprintf(stderr, "invalid object list\n");
+    free_world(&s);
+    return 1;
+  }
+  if(ref_b)
+    clone_world(&ref, &s);
+  // O modo de verificação compara todas as gerações, não pode saltar nenhuma
+  if(cache_dir && !ref_b && open_cache(&s, cache_dir, cache_mib << 20) != 0) {
+    perror(cache_dir);
+    return 1;
+  }
+  if(stats_path && open_stats(&s, stats_path) != 0) {
+    perror(stats_path);
+    return 1;
+  }
+
+  sim_start(&s, b);
+  if(ref_b)
+    sim_start(&ref, ref_b);
+  if(record_prefix && open_recorder(&s, record_prefix, keyframe_interval) != 0) {
+    perror(record_prefix);
+    return 1;
+  }
+  if(profiling && !ref_b)
+    open_profile(&s);
+
+  double start_time = omp_get_wtime();
+  if(ref_b)
+    status = verify(&ref, &s);
+  else if(s.cache)
+    cache_run(&s);
+  else
+    sim_run(&s, s.n_gen - s.current_gen);
+  double final_time = omp_get_wtime();
+
+  printf("%.5lf\n",(final_time - start_time)*1000);
+  output(&s);
+
+  if(close_recorder(&s) != 0)
+    status = 1;
+  close_stats(&s);
+  close_cache(&s);
+  close_profile(&s);
+  sim_end(&s);
+  free_world(&s);
+  if(ref_b) {
+    sim_end(&ref);
+    free_world(&ref);
+  }
+  return status;
+}
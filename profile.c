@@ -0,0 +1,246 @@
+#include<stdio.h>
+#include<stdlib.h>
+#include<string.h>
+#include<stdint.h>
+#include<errno.h>
+#include<unistd.h>
+#include<sys/ioctl.h>
+#include<sys/syscall.h>
+#include<linux/perf_event.h>
+#include<omp.h>
+#include "ecosystem.h"
+
+/* Hardware counter profile of the generation loop. Every thread of the team opens
+   its own counter group (user space only, so perf_event_paranoid <= 2 is enough)
+   and a single thread reads all groups around every phase, so the counts of each
+   phase are split by thread. Phases are marked outside parallel regions or, inside
+   one, from a single construct while the rest of the team waits. Cache-line transfers have no generic event: set
+   ECO_PERF_XFER to the raw event code of the machine (e.g. the HITM load event)
+   to count them. Events the machine or container does not offer are reported as
+   "-"; without any counters only the time per phase is left. */
+
+enum { EV_CYCLES, EV_INSTRUCTIONS, EV_LLC_MISSES, EV_BRANCHES, EV_BRANCH_MISSES, EV_XFER, N_EVENTS };
+
+static const char *phase_names[N_PHASES] = {"r-move", "r-carry", "f-move", "f-reset", "reduce", "record", "run"};
+
+typedef struct counters_ {
+  uint64_t value[N_EVENTS];
+  uint64_t enabled;
+  uint64_t running;
+}counters;
+
+typedef struct thread_counters_ {
+  int fd[N_EVENTS];
+  // Posição de cada evento na leitura do grupo, -1 se não abriu
+  int slot[N_EVENTS];
+  int n_open;
+  counters last;
+}thread_counters;
+
+typedef struct profile_ {
+  int n_threads;
+  int available;
+  thread_counters *threads;
+  // Contagens acumuladas por fase e por thread: acc[phase * n_threads + thread]
+  counters *acc;
+  double time[N_PHASES];
+  long calls[N_PHASES];
+  double start;
+}profile;
+
+static int open_event(uint32_t type, uint64_t config, int group) {
+  struct perf_event_attr attr;
+  memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  attr.type = type;
+  attr.config = config;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED |
+                     PERF_FORMAT_TOTAL_TIME_RUNNING;
+  attr.disabled = group == -1;
+  return (int)syscall(SYS_perf_event_open, &attr, 0, -1, group, 0);
+}
+
+/* Opens the calling thread's group. Cycles lead it; the others join if they can */
+static int open_group(thread_counters *t, const char *xfer) {
+  int e;
+  for(e = 0; e < N_EVENTS; e++) {
+    t->fd[e] = -1;
+    t->slot[e] = -1;
+  }
+  t->n_open = 0;
+  t->fd[EV_CYCLES] = open_event(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES, -1);
+  if(t->fd[EV_CYCLES] < 0)
+    return -errno;
+  t->slot[EV_CYCLES] = t->n_open++;
+  for(e = EV_INSTRUCTIONS; e < N_EVENTS; e++) {
+    int leader = t->fd[EV_CYCLES];
+    switch(e) {
+    case EV_INSTRUCTIONS: t->fd[e] = open_event(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS, leader); break;
+    case EV_LLC_MISSES: t->fd[e] = open_event(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES, leader); break;
+    case EV_BRANCHES: t->fd[e] = open_event(PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_INSTRUCTIONS, leader); break;
+    case EV_BRANCH_MISSES: t->fd[e] = open_event(PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES, leader); break;
+    case EV_XFER:
+      if(xfer)
+        t->fd[e] = open_event(PERF_TYPE_RAW, strtoull(xfer, NULL, 0), leader);
+      break;
+    }
+    if(t->fd[e] >= 0)
+      t->slot[e] = t->n_open++;
+  }
+  ioctl(t->fd[EV_CYCLES], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+  ioctl(t->fd[EV_CYCLES], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+  return 0;
+}
+
+static void read_group(const thread_counters *t, counters *c) {
+  uint64_t buf[3 + N_EVENTS];
+  int e;
+  memset(c, 0, sizeof(*c));
+  if(t->fd[EV_CYCLES] < 0 || read(t->fd[EV_CYCLES], buf, sizeof(buf)) < (ssize_t)(3 * sizeof(uint64_t)))
+    return;
+  c->enabled = buf[1];
+  c->running = buf[2];
+  for(e = 0; e < N_EVENTS; e++)
+    if(t->slot[e] >= 0 && t->slot[e] < (int)buf[0])
+      c->value[e] = buf[3 + t->slot[e]];
+}
+
+/* Opens one counter group per thread of the team. Never fails: without counters
+   the profile still times the phases */
+void open_profile(sim *s) {
+  profile *p = (profile *)calloc(1, sizeof(profile));
+  const char *xfer = getenv("ECO_PERF_XFER");
+  int err = 0, t;
+
+  p->n_threads = s->n_workers;
+  p->threads = (thread_counters *)calloc(p->n_threads, sizeof(thread_counters));
+  p->acc = (counters *)calloc((size_t)N_PHASES * p->n_threads, sizeof(counters));
+  for(t = 0; t < p->n_threads; t++)
+    p->threads[t].fd[EV_CYCLES] = -1;
+
+  // Cada thread abre o seu grupo: os contadores seguem a thread que os abriu
+  #pragma omp parallel num_threads(p->n_threads)
+  {
+    int r = open_group(&p->threads[omp_get_thread_num()], xfer);
+    if(r < 0) {
+      #pragma omp atomic write
+      err = -r;
+    }
+  }
+  p->available = p->threads[0].fd[EV_CYCLES] >= 0;
+  if(!p->available)
+    fprintf(stderr, "profile: hardware counters unavailable (%s), timing phases only\n",
+            strerror(err));
+  s->profile = p;
+}
+
+/* Marks the start of a phase; only one thread of the team may call it */
+void profile_begin(sim *s) {
+  profile *p = s->profile;
+  int t;
+  if(!p)
+    return;
+  for(t = 0; p->available && t < p->n_threads; t++)
+    read_group(&p->threads[t], &p->threads[t].last);
+  p->start = omp_get_wtime();
+}
+
+/* Charges everything counted since profile_begin() to phase */
+void profile_end(sim *s, int phase) {
+  profile *p = s->profile;
+  counters now;
+  int t, e;
+  if(!p)
+    return;
+  p->time[phase] += omp_get_wtime() - p->start;
+  p->calls[phase]++;
+  for(t = 0; p->available && t < p->n_threads; t++) {
+    counters *a = &p->acc[phase * p->n_threads + t];
+    const counters *last = &p->threads[t].last;
+    read_group(&p->threads[t], &now);
+    for(e = 0; e < N_EVENTS; e++)
+      a->value[e] += now.value[e] - last->value[e];
+    a->enabled += now.enabled - last->enabled;
+    a->running += now.running - last->running;
+  }
+}
+
+/* Value of event e corrected for multiplexing, or -1 if it was never counted */
+static double scaled(const thread_counters *t, const counters *c, int e) {
+  if(t->slot[e] < 0)
+    return -1;
+  // Uma thread que não correu nesta fase não contou nada
+  if(c->running == 0)
+    return 0;
+  return (double)c->value[e] * c->enabled / c->running;
+}
+
+static void print_ratio(double num, double den, double scale) {
+  if(num < 0 || den <= 0)
+    fprintf(stderr, " %10s", "-");
+  else
+    fprintf(stderr, " %10.3f", num / den * scale);
+}
+
+static void print_row(const char *phase, const char *thread, const double v[N_EVENTS]) {
+  fprintf(stderr, "%-8s %-6s", phase, thread);
+  if(v[EV_CYCLES] < 0)
+    fprintf(stderr, " %14s", "-");
+  else
+    fprintf(stderr, " %14.0f", v[EV_CYCLES]);
+  print_ratio(v[EV_INSTRUCTIONS], v[EV_CYCLES], 1);
+  print_ratio(v[EV_LLC_MISSES], v[EV_INSTRUCTIONS], 1000);
+  print_ratio(v[EV_BRANCH_MISSES], v[EV_BRANCHES], 100);
+  print_ratio(v[EV_XFER], v[EV_INSTRUCTIONS], 1000);
+  fprintf(stderr, "\n");
+}
+
+/* Prints the report on stderr and closes the counters */
+void close_profile(sim *s) {
+  profile *p = s->profile;
+  int ph, t, e;
+  if(!p)
+    return;
+
+  fprintf(stderr, "profile: %d threads\n", p->n_threads);
+  fprintf(stderr, "%-8s %8s %12s\n", "phase", "calls", "time ms");
+  for(ph = 0; ph < N_PHASES; ph++)
+    if(p->calls[ph])
+      fprintf(stderr, "%-8s %8ld %12.3f\n", phase_names[ph], p->calls[ph], p->time[ph] * 1000);
+
+  if(p->available) {
+    fprintf(stderr, "%-8s %-6s %14s %10s %10s %10s %10s\n",
+            "phase", "thread", "cycles", "IPC", "LLC MPKI", "br miss %", "xfer PKI");
+    for(ph = 0; ph < N_PHASES; ph++) {
+      double total[N_EVENTS];
+      if(!p->calls[ph])
+        continue;
+      for(e = 0; e < N_EVENTS; e++)
+        total[e] = -1;
+      for(t = 0; t < p->n_threads; t++) {
+        const counters *a = &p->acc[ph * p->n_threads + t];
+        double v[N_EVENTS];
+        char name[16];
+        for(e = 0; e < N_EVENTS; e++) {
+          v[e] = scaled(&p->threads[t], a, e);
+          if(v[e] >= 0)
+            total[e] = (total[e] < 0 ? 0 : total[e]) + v[e];
+        }
+        snprintf(name, sizeof(name), "%d", t);
+        print_row(phase_names[ph], name, v);
+      }
+      print_row(phase_names[ph], "all", total);
+    }
+  }
+
+  for(t = 0; t < p->n_threads; t++)
+    for(e = 0; e < N_EVENTS; e++)
+      if(p->threads[t].fd[e] >= 0)
+        close(p->threads[t].fd[e]);
+  free(p->threads);
+  free(p->acc);
+  free(p);
+  s->profile = NULL;
+}
@@ -0,0 +1,662 @@
+#include<stdio.h>
+#include<stdlib.h>
+#include<string.h>
+#include<stdint.h>
+#include<errno.h>
+#include<pthread.h>
+#include "ecosystem.h"
+
+/* Trajectory files written next to each other:
+     <prefix>.traj  header, then one frame per recorded generation
+     <prefix>.idx   header, then the file offset of every keyframe
+   Frames are varints, every cell coded as its distance to the previous one so the
+   distances stay small. A keyframe is a snapshot: the rocks as bare cells, then a
+   record per creature (cell, type, num_gen and, for foxes, num_food), both in grid
+   order. A delta holds one move event per creature of the previous frame, in grid
+   order: the distance to the previous creature times 8 plus the move code the
+   kernel logged (stay, a direction, or starved). Replay puts every creature where
+   its event says through the kernels' own place_rabbit()/place_fox(), which work
+   out births, ages, food and conflicts again, so a delta costs about a byte per
+   creature. A delta bigger than the keyframe of the same generation is written as
+   that keyframe instead. Frame g is the world after g generations. */
+
+#define TRAJ_MAGIC "ECOTRAJ3"
+#define IDX_MAGIC "ECOIDX01"
+#define QUEUE_SLOTS 64
+// Mínimo da fila; cresce para caberem sempre duas keyframes do mundo inteiro
+#define QUEUE_BYTES (64u << 20)
+
+enum { FRAME_KEY = 'K', FRAME_DELTA = 'D' };
+
+typedef struct file_header_ {
+  char magic[8];
+  int32_t gen_proc_rabbits;
+  int32_t gen_proc_foxes;
+  int32_t gen_food_foxes;
+  int32_t R;
+  int32_t C;
+  int32_t keyframe_interval;
+}file_header;
+
+// Pior caso de um varint de 32 bits e de um registo de criatura
+#define VARINT_MAX 5
+#define RECORD_MAX (3 * VARINT_MAX + 1)
+
+typedef struct frame_header_ {
+  int32_t kind;
+  int32_t gen;
+  int32_t n_bare;
+  int32_t count;
+  int32_t bytes;
+  int32_t pad;
+}frame_header;
+
+typedef struct frame_ {
+  frame_header h;
+  unsigned char data[];
+}frame;
+
+typedef struct index_entry_ {
+  int32_t gen;
+  int32_t pad;
+  int64_t offset;
+}index_entry;
+
+typedef struct recorder_ {
+  FILE *traj;
+  FILE *idx;
+  int keyframe_interval;
+  // Código de movimento + 1 de cada célula, para pôr os eventos por ordem da grelha
+  unsigned char *code;
+  int rocks;
+  // Bytes das rochas numa keyframe e média por criatura na última keyframe
+  size_t rock_bytes;
+  double record_bytes;
+  int need_keyframe;
+  int failed;
+  long dropped;
+  // Primeiro erro de escrita (errno) e última geração que chegou ao ficheiro
+  int write_error;
+  int written_gen;
+  size_t max_bytes;
+  // Fila limitada entre a simulação e a thread que escreve no disco
+  frame *queue[QUEUE_SLOTS];
+  int head;
+  int len;
+  size_t queued_bytes;
+  int done;
+  pthread_t thread;
+  pthread_mutex_t lock;
+  pthread_cond_t ready;
+}recorder;
+
+static size_t frame_size(const frame *f) {
+  return sizeof(frame) + f->h.bytes;
+}
+
+/* Largest possible frame with n_bare bare cells and count records */
+static size_t frame_bound(int n_bare, int count) {
+  return sizeof(frame) + (size_t)n_bare * VARINT_MAX + (size_t)count * RECORD_MAX;
+}
+
+/* Varint: 7 bits per byte, low bits first */
+static unsigned char *put_uint(unsigned char *p, uint32_t z) {
+  while(z >= 0x80) {
+    *p++ = (unsigned char)(z | 0x80);
+    z >>= 7;
+  }
+  *p++ = (unsigned char)z;
+  return p;
+}
+
+static const unsigned char *get_uint(const unsigned char *p, const unsigned char *end, uint32_t *z) {
+  int shift;
+  *z = 0;
+  for(shift = 0; p < end && shift < 7 * VARINT_MAX; shift += 7) {
+    unsigned char b = *p++;
+    *z |= (uint32_t)(b & 0x7f) << shift;
+    if(!(b & 0x80))
+      return p;
+  }
+  return NULL;
+}
+
+/* Zigzag varint: small values of either sign take one byte */
+static unsigned char *put_int(unsigned char *p, int v) {
+  return put_uint(p, ((uint32_t)v << 1) ^ (uint32_t)(v >> 31));
+}
+
+static const unsigned char *get_int(const unsigned char *p, const unsigned char *end, int *v) {
+  uint32_t z;
+  if(!(p = get_uint(p, end, &z)))
+    return NULL;
+  *v = (int)(z >> 1) ^ -(int)(z & 1);
+  return p;
+}
+
+static unsigned char *put_record(unsigned char *p, int cell, int prev, const object *o) {
+  p = put_int(p, cell - prev - 1);
+  *p++ = (unsigned char)o->type;
+  p = put_int(p, o->num_gen);
+  if(o->type == 'F')
+    p = put_int(p, o->num_food);
+  return p;
+}
+
+/* Writer thread: the only place that touches the disk. After the first failed
+   write it only drains the queue; the error is reported by close_recorder() */
+static void *writer_main(void *arg) {
+  recorder *r = (recorder *)arg;
+  for(;;) {
+    frame *f;
+    int err = 0;
+    pthread_mutex_lock(&r->lock);
+    while(r->len == 0 && !r->done)
+      pthread_cond_wait(&r->ready, &r->lock);
+    if(r->len == 0) {
+      pthread_mutex_unlock(&r->lock);
+      break;
+    }
+    f = r->queue[r->head];
+    r->head = (r->head + 1) % QUEUE_SLOTS;
+    r->len--;
+    pthread_mutex_unlock(&r->lock);
+
+    if(!r->write_error) {
+      index_entry e;
+      memset(&e, 0, sizeof(e));
+      e.gen = f->h.gen;
+      e.offset = ftello(r->traj);
+      // A keyframe só entra no índice depois de escrita
+      if(e.offset < 0 || fwrite(f, frame_size(f), 1, r->traj) != 1 ||
+         (f->h.kind == FRAME_KEY && fwrite(&e, sizeof(e), 1, r->idx) != 1))
+        err = errno ? errno : EIO;
+      else
+        r->written_gen = f->h.gen;
+    }
+
+    pthread_mutex_lock(&r->lock);
+    r->queued_bytes -= frame_size(f);
+    if(err)
+      r->write_error = err;
+    pthread_mutex_unlock(&r->lock);
+    free(f);
+  }
+  return NULL;
+}
+
+static int queue_has_room(recorder *r, size_t size) {
+  int room;
+  pthread_mutex_lock(&r->lock);
+  room = r->len < QUEUE_SLOTS && r->queued_bytes + size <= r->max_bytes;
+  pthread_mutex_unlock(&r->lock);
+  return room;
+}
+
+/* Hands a frame to the writer. Never waits for the disk: when the queue is full
+   the frame is dropped and the next generation is recorded as a keyframe instead.
+   Once the writer has failed recording stops */
+static void push_frame(recorder *r, frame *f) {
+  size_t size = frame_size(f);
+  pthread_mutex_lock(&r->lock);
+  if(r->write_error) {
+    pthread_mutex_unlock(&r->lock);
+    free(f);
+    r->failed = 1;
+    return;
+  }
+  if(r->len == QUEUE_SLOTS || r->queued_bytes + size > r->max_bytes) {
+    pthread_mutex_unlock(&r->lock);
+    free(f);
+    r->dropped++;
+    r->need_keyframe = 1;
+    return;
+  }
+  r->queue[(r->head + r->len) % QUEUE_SLOTS] = f;
+  r->len++;
+  r->queued_bytes += size;
+  if(f->h.kind == FRAME_KEY)
+    r->need_keyframe = 0;
+  pthread_cond_signal(&r->ready);
+  pthread_mutex_unlock(&r->lock);
+}
+
+/* Snapshot of the world: the rocks as bare cells, then every creature */
+static frame *build_keyframe(const sim *s) {
+  int x, y, rocks = 0, n = 0, prev_rock = -1, prev = -1;
+  unsigned char *bare, *start, *p;
+  frame *f;
+  for(x = 0; x < s->R; x++)
+    for(y = 0; y < s->C; y++) {
+      char t = CELL(s, s->world, x, y).type;
+      rocks += t == '*';
+      n += t == 'R' || t == 'F';
+    }
+  // As rochas vão para o início, as criaturas depois do espaço máximo das rochas
+  f = (frame *)malloc(frame_bound(rocks, n));
+  bare = f->data;
+  start = p = f->data + (size_t)rocks * VARINT_MAX;
+  for(x = 0; x < s->R; x++)
+    for(y = 0; y < s->C; y++) {
+      const object *o = &CELL(s, s->world, x, y);
+      int cell = x * s->C + y;
+      if(o->type == '*') {
+        bare = put_int(bare, cell - prev_rock - 1);
+        prev_rock = cell;
+      }
+      else if(o->type != ' ') {
+        p = put_record(p, cell, prev, o);
+        prev = cell;
+      }
+    }
+  memmove(bare, start, p - start);
+  f->h.kind = FRAME_KEY;
+  f->h.gen = s->current_gen;
+  f->h.n_bare = rocks;
+  f->h.count = n;
+  f->h.bytes = (int32_t)((bare - f->data) + (p - start));
+  return (frame *)realloc(f, frame_size(f));
+}
+
+/* Move events of the generation that just finished, one per creature that was on
+   the grid at its start. The workers log them in whatever order they ran, so they
+   are first spread over the grid and then collected in grid order */
+static frame *build_delta(sim *s, recorder *r) {
+  int i, k, n = 0, count = 0, prev = -1, cell;
+  unsigned char *p;
+  frame *f;
+  for(i = 0; i < s->n_workers; i++) {
+    worker *w = &s->workers[i];
+    for(k = 0; k < w->n_moves; k++)
+      r->code[w->moves[k] >> 3] = (unsigned char)((w->moves[k] & 7) + 1);
+    n += w->n_moves;
+  }
+  f = (frame *)malloc(frame_bound(n, 0));
+  p = f->data;
+  for(cell = 0; count < n && cell < s->R * s->C; cell++) {
+    if(!r->code[cell])
+      continue;
+    p = put_uint(p, (uint32_t)(cell - prev - 1) << 3 | (r->code[cell] - 1));
+    r->code[cell] = 0;
+    prev = cell;
+    count++;
+  }
+  f->h.kind = FRAME_DELTA;
+  f->h.gen = s->current_gen;
+  f->h.n_bare = 0;
+  f->h.count = count;
+  f->h.bytes = (int32_t)(p - f->data);
+  return (frame *)realloc(f, frame_size(f));
+}
+
+/* Keeps the average record size of the keyframes for the delta-or-keyframe choice */
+static void note_keyframe(recorder *r, const frame *f) {
+  if(f->h.count > 0)
+    r->record_bytes = (double)(f->h.bytes - r->rock_bytes) / f->h.count;
+}
+
+static void clear_moves(sim *s) {
+  int i;
+  for(i = 0; i < s->n_workers; i++)
+    s->workers[i].n_moves = 0;
+}
+
+/* Starts recording: writes the file headers, enables the kernels' move logs and
+   records the current world as the first keyframe */
+int open_recorder(sim *s, const char *prefix, int keyframe_interval) {
+  char path[4096];
+  file_header h;
+  recorder *r;
+  frame *f;
+  int i, prev;
+
+  r = (recorder *)calloc(1, sizeof(recorder));
+  snprintf(path, sizeof(path), "%s.traj", prefix);
+  r->traj = fopen(path, "wb");
+  snprintf(path, sizeof(path), "%s.idx", prefix);
+  r->idx = fopen(path, "wb");
+  if(!r->traj || !r->idx) {
+    if(r->traj)
+      fclose(r->traj);
+    if(r->idx)
+      fclose(r->idx);
+    free(r);
+    return -1;
+  }
+  r->keyframe_interval = keyframe_interval > 0 ? keyframe_interval : 1;
+
+  memset(&h, 0, sizeof(h));
+  memcpy(h.magic, TRAJ_MAGIC, sizeof(h.magic));
+  h.gen_proc_rabbits = s->gen_proc_rabbits;
+  h.gen_proc_foxes = s->gen_proc_foxes;
+  h.gen_food_foxes = s->gen_food_foxes;
+  h.R = s->R;
+  h.C = s->C;
+  h.keyframe_interval = r->keyframe_interval;
+  i = fwrite(&h, sizeof(h), 1, r->traj) == 1;
+  memcpy(h.magic, IDX_MAGIC, sizeof(h.magic));
+  if(!i || fwrite(&h, sizeof(h), 1, r->idx) != 1) {
+    fclose(r->traj);
+    fclose(r->idx);
+    free(r);
+    return -1;
+  }
+
+  r->code = (unsigned char *)calloc((size_t)s->R * s->C, 1);
+  r->written_gen = -1;
+  // As rochas não mudam: uma keyframe custa sempre os mesmos bytes de rochas
+  for(i = 0, prev = -1; i < s->R * s->C; i++)
+    if(CELL(s, s->world, i / s->C, i % s->C).type == '*') {
+      unsigned char tmp[VARINT_MAX];
+      r->rock_bytes += put_int(tmp, i - prev - 1) - tmp;
+      r->rocks++;
+      prev = i;
+    }
+  r->record_bytes = RECORD_MAX;
+  r->max_bytes = 2 * frame_bound(r->rocks, s->R * s->C - r->rocks);
+  if(r->max_bytes < QUEUE_BYTES)
+    r->max_bytes = QUEUE_BYTES;
+  for(i = 0; i < s->n_workers; i++) {
+    s->workers[i].cap_moves = 1024;
+    s->workers[i].n_moves = 0;
+    s->workers[i].moves = (long long *)malloc(s->workers[i].cap_moves * sizeof(long long));
+  }
+
+  pthread_mutex_init(&r->lock, NULL);
+  pthread_cond_init(&r->ready, NULL);
+  pthread_create(&r->thread, NULL, writer_main, r);
+  s->recorder = r;
+
+  f = build_keyframe(s);
+  note_keyframe(r, f);
+  push_frame(r, f);
+  return 0;
+}
+
+/* Records the generation that just finished, called from sim_step() */
+void record_generation(sim *s) {
+  recorder *r = s->recorder;
+  int creatures = s->stats.rabbits + s->stats.foxes;
+  size_t key_bound = frame_bound(r->rocks, creatures);
+  // Estimativa da keyframe desta geração, pela média da última
+  size_t key_size = sizeof(frame) + r->rock_bytes + (size_t)(creatures * r->record_bytes);
+  frame *f = NULL;
+  if(r->failed) {
+    clear_moves(s);
+    return;
+  }
+  if(key_bound > r->max_bytes) {
+    // Não deve acontecer, a fila é dimensionada para o mundo inteiro
+    fprintf(stderr, "recorder: a keyframe of %zu bytes does not fit the queue, "
+            "recording stopped at generation %d\n", key_bound, s->current_gen);
+    r->failed = 1;
+    clear_moves(s);
+    return;
+  }
+  if(!r->need_keyframe && s->current_gen % r->keyframe_interval != 0) {
+    f = build_delta(s, r);
+    if(frame_size(f) > key_size) {
+      free(f);
+      f = NULL;
+    }
+  }
+  clear_moves(s);
+  if(!f) {
+    // Fila ainda cheia: não vale a pena varrer a grelha para deitar a keyframe fora
+    if(!queue_has_room(r, key_bound)) {
+      r->dropped++;
+      r->need_keyframe = 1;
+      return;
+    }
+    f = build_keyframe(s);
+    note_keyframe(r, f);
+  }
+  push_frame(r, f);
+}
+
+/* Drains the queue, closes both files and turns the move logs off. Returns -1
+   if the trajectory could not be written in full */
+int close_recorder(sim *s) {
+  recorder *r = s->recorder;
+  int i, status = 0;
+  if(!r)
+    return 0;
+  pthread_mutex_lock(&r->lock);
+  r->done = 1;
+  pthread_cond_signal(&r->ready);
+  pthread_mutex_unlock(&r->lock);
+  pthread_join(r->thread, NULL);
+  pthread_mutex_destroy(&r->lock);
+  pthread_cond_destroy(&r->ready);
+
+  // O fclose ainda despeja o buffer do stdio e pode ser ele a falhar
+  if(fclose(r->traj) != 0 && !r->write_error)
+    r->write_error = errno ? errno : EIO;
+  if(fclose(r->idx) != 0 && !r->write_error)
+    r->write_error = errno ? errno : EIO;
+  if(r->dropped)
+    fprintf(stderr, "recorder: dropped %ld frames, replaced by keyframes\n", r->dropped);
+  if(r->write_error) {
+    fprintf(stderr, "recorder: writing the trajectory failed (%s), "
+            "it may stop before generation %d\n", strerror(r->write_error), r->written_gen + 1);
+    status = -1;
+  }
+
+  for(i = 0; i < s->n_workers; i++) {
+    free(s->workers[i].moves);
+    s->workers[i].moves = NULL;
+    s->workers[i].n_moves = s->workers[i].cap_moves = 0;
+  }
+  free(r->code);
+  free(r);
+  s->recorder = NULL;
+  return status;
+}
+
+/* Replaces the world with a keyframe: an empty grid, the rocks, then the creatures */
+static int decode_keyframe(sim *s, const frame_header *fh, const unsigned char *p,
+                           const unsigned char *end) {
+  int x, y, k, cell = -1, gap;
+  for(x = 0; x < s->R; x++)
+    for(y = 0; y < s->C; y++) {
+      CELL(s, s->world, x, y).type = ' ';
+      CELL(s, s->world, x, y).num_gen = 0;
+      CELL(s, s->world, x, y).num_food = 0;
+    }
+  for(k = 0; k < fh->n_bare; k++) {
+    if(!(p = get_int(p, end, &gap)))
+      return -1;
+    cell += gap + 1;
+    if(cell < 0 || cell >= s->R * s->C)
+      return -1;
+    object *o = &CELL(s, s->world, cell / s->C, cell % s->C);
+    o->type = '*';
+    o->num_gen = 0;
+    o->num_food = 0;
+  }
+  cell = -1;
+  for(k = 0; k < fh->count; k++) {
+    int num_gen, num_food = 0;
+    char type;
+    if(!(p = get_int(p, end, &gap)) || p == end)
+      return -1;
+    cell += gap + 1;
+    type = (char)*p++;
+    if(cell < 0 || cell >= s->R * s->C || (type != 'R' && type != 'F') ||
+       !(p = get_int(p, end, &num_gen)) || (type == 'F' && !(p = get_int(p, end, &num_food))))
+      return -1;
+    object *o = &CELL(s, s->world, cell / s->C, cell % s->C);
+    o->type = type;
+    o->num_gen = num_gen;
+    o->num_food = num_food;
+  }
+  return 0;
+}
+
+/* Reads the move events of a delta as cell * 8 + move code, checking that there
+   is one for every creature of the world and that no creature leaves the grid */
+static int *decode_moves(sim *s, const frame_header *fh, const unsigned char *p,
+                         const unsigned char *end) {
+  int *events = (int *)malloc((fh->count > 0 ? fh->count : 1) * sizeof(int));
+  int x, y, k, cell = -1, creatures = 0;
+  uint32_t v;
+  for(x = 0; x < s->R; x++)
+    for(y = 0; y < s->C; y++)
+      creatures += CELL(s, s->world, x, y).type == 'R' || CELL(s, s->world, x, y).type == 'F';
+  for(k = 0; k < fh->count && creatures == fh->count; k++) {
+    int code;
+    char type;
+    if(!(p = get_uint(p, end, &v)) || (v >> 3) >= (uint32_t)(s->R * s->C))
+      break;
+    cell += (int)(v >> 3) + 1;
+    code = v & 7;
+    if(cell >= s->R * s->C || code > MOVE_STARVED)
+      break;
+    x = cell / s->C;
+    y = cell % s->C;
+    type = CELL(s, s->world, x, y).type;
+    if((type != 'R' && type != 'F') || (type == 'R' && code == MOVE_STARVED) ||
+       (code < MOVE_STARVED && (x + move_dx[code] < 0 || x + move_dx[code] >= s->R ||
+                                y + move_dy[code] < 0 || y + move_dy[code] >= s->C)))
+      break;
+    events[k] = cell << 3 | code;
+  }
+  if(k < fh->count || creatures != fh->count) {
+    free(events);
+    return NULL;
+  }
+  return events;
+}
+
+/* Advances the world one generation with the moves of a delta, the same steps
+   rabbit_phase() and fox_phase() take around the kernels */
+static int apply_moves(sim *s, const frame_header *fh, const unsigned char *p,
+                       const unsigned char *end) {
+  int *events = decode_moves(s, fh, p, end);
+  worker w;
+  int k, t, x, y;
+  if(!events)
+    return -1;
+  // Sem registo de movimentos: os contadores deste worker não são usados
+  memset(&w, 0, sizeof(w));
+  // O novo mundo começa com as rochas e as raposas, que não se mexem na fase dos coelhos
+  for(x = 0; x < s->R; x++)
+    for(y = 0; y < s->C; y++) {
+      object *n = &CELL(s, s->new_world, x, y);
+      *n = CELL(s, s->world, x, y);
+      if(n->type != '*' && n->type != 'F') {
+        n->type = ' ';
+        n->num_gen = 0;
+        n->num_food = 0;
+      }
+    }
+  // Coelhos, marcando os eventos já aplicados
+  for(k = 0; k < fh->count; k++) {
+    int cell = events[k] >> 3, code = events[k] & 7;
+    x = cell / s->C;
+    y = cell % s->C;
+    if(CELL(s, s->world, x, y).type != 'R')
+      continue;
+    place_rabbit(s, &w, s->new_world, CELL(s, s->world, x, y), x, y, x + move_dx[code], y + move_dy[code]);
+    events[k] = -1;
+  }
+  swap_worlds(s);
+  for(t = 0; t < s->n_slots; t++)
+    carry_rabbits(s, s->world, s->new_world, t);
+  for(k = 0; k < fh->count; k++) {
+    int cell = events[k] >> 3, code = events[k] & 7;
+    if(events[k] < 0 || code == MOVE_STARVED)
+      continue;
+    x = cell / s->C;
+    y = cell % s->C;
+    place_fox(s, &w, s->new_world, CELL(s, s->world, x, y), x, y, x + move_dx[code], y + move_dy[code]);
+  }
+  swap_worlds(s);
+  free(events);
+  return 0;
+}
+
+static int apply_frame(sim *s, FILE *traj, const frame_header *fh) {
+  unsigned char *data;
+  int status = -1;
+  if(fh->n_bare < 0 || fh->count < 0 || fh->bytes < 0)
+    return -1;
+  data = (unsigned char *)malloc(fh->bytes > 0 ? fh->bytes : 1);
+  if(fread(data, 1, fh->bytes, traj) == (size_t)fh->bytes) {
+    if(fh->kind == FRAME_KEY)
+      status = decode_keyframe(s, fh, data, data + fh->bytes);
+    else
+      status = apply_moves(s, fh, data, data + fh->bytes);
+  }
+  free(data);
+  return status;
+}
+
+/* Rebuilds generation gen of a recorded trajectory into s (which gets allocated):
+   seeks to the nearest keyframe at or before gen and applies deltas from there */
+int replay(sim *s, const char *prefix, int gen) {
+  char path[4096];
+  file_header h;
+  index_entry e;
+  frame_header fh;
+  FILE *idx, *traj;
+  int64_t offset = -1;
+  int at = -1;
+
+  snprintf(path, sizeof(path), "%s.idx", prefix);
+  idx = fopen(path, "rb");
+  if(!idx)
+    return -1;
+  if(fread(&h, sizeof(h), 1, idx) != 1 || memcmp(h.magic, IDX_MAGIC, sizeof(h.magic)) != 0) {
+    fclose(idx);
+    return -1;
+  }
+  while(fread(&e, sizeof(e), 1, idx) == 1)
+    if(e.gen <= gen && e.gen > at) {
+      at = e.gen;
+      offset = e.offset;
+    }
+  fclose(idx);
+  if(offset < 0)
+    return -1;
+
+  snprintf(path, sizeof(path), "%s.traj", prefix);
+  traj = fopen(path, "rb");
+  if(!traj)
+    return -1;
+  if(fread(&h, sizeof(h), 1, traj) != 1 || memcmp(h.magic, TRAJ_MAGIC, sizeof(h.magic)) != 0 ||
+     fseeko(traj, offset, SEEK_SET) != 0) {
+    fclose(traj);
+    return -1;
+  }
+
+  memset(s, 0, sizeof(*s));
+  s->gen_proc_rabbits = h.gen_proc_rabbits;
+  s->gen_proc_foxes = h.gen_proc_foxes;
+  s->gen_food_foxes = h.gen_food_foxes;
+  s->R = h.R;
+  s->C = h.C;
+  s->n_gen = gen;
+  alloc_world(s);
+  init_world(s);
+  s->new_world = alloc_grid(s);
+
+  at = -1;
+  while(at < gen && fread(&fh, sizeof(fh), 1, traj) == 1) {
+    // Um delta só se aplica à geração imediatamente anterior
+    if(fh.gen > gen || (fh.kind == FRAME_DELTA && fh.gen != at + 1) ||
+       (fh.kind != FRAME_DELTA && fh.kind != FRAME_KEY))
+      break;
+    if(apply_frame(s, traj, &fh) != 0)
+      break;
+    at = fh.gen;
+  }
+  fclose(traj);
+  if(at != gen) {
+    free_world(s);
+    return -1;
+  }
+
+  s->current_gen = gen;
+  return 0;
+}
@@ -0,0 +1,767 @@
+#include<stdio.h>
+#include<stdlib.h>
+#include<string.h>
+#include<stdint.h>
+#include<errno.h>
+#include<signal.h>
+#include<poll.h>
+#include<fcntl.h>
+#include<unistd.h>
+#include<pthread.h>
+#include<sys/socket.h>
+#include<sys/un.h>
+#include<omp.h>
+#include "ecosystem.h"
+
+/* Resident mode: worlds stay loaded in one process and are driven over a Unix
+   domain socket, so a query pays neither process startup, parsing nor lock setup.
+   Every request is a request_header plus len bytes of payload, every reply a
+   response_header plus len bytes. Client sockets are non-blocking: requests are
+   buffered per client and served one at a time once complete, replies are written
+   as the client reads them, so a slow or stalled client never holds up the others.
+   Steps run on a stepping thread that owns the OpenMP team, one after the other,
+   and the poll thread hears of each finished step through a pipe. Meanwhile every
+   other world is served as usual; a request for a world with a step queued or
+   running waits for that step, so it sees the world it advanced to. */
+
+enum {
+  OP_LOAD = 1,     // payload: input file text           reply: uint32 world
+  OP_STEP,         // payload: int32 n                   reply: int32 current_gen
+  OP_SNAPSHOT,     //                                    reply: int32 gen, R, C, then R*C types
+  OP_FORK,         //                                    reply: uint32 new world
+  OP_REGION,       // payload: int32 x0, y0, x1, y1      reply: types of rows x0..x1-1, cols y0..y1-1
+  OP_COUNTS,       //                                    reply: int32 gen, rabbits, foxes, rocks
+  OP_FREE,         //                                    reply: nothing
+};
+
+typedef struct request_header_ {
+  uint32_t op;
+  uint32_t world;
+  uint32_t len;
+}request_header;
+
+typedef struct response_header_ {
+  int32_t status;
+  uint32_t len;
+}response_header;
+
+#define MAX_PAYLOAD (64u << 20)
+#define MAX_CLIENTS 64
+// fds[0] é o socket de escuta e fds[1] o pipe do stepper, os clientes vêm depois
+#define FIRST_CLIENT 2
+// Gerações que o stepper corre de seguida antes de passar à step seguinte
+#define STEP_SLICE 64
+
+/* One client connection: the request being received and the reply being sent */
+typedef struct conn_ {
+  int fd;
+  unsigned long id;
+  request_header h;
+  size_t have;     // bytes recebidos do pedido atual, cabeçalho incluído
+  char *payload;
+  int ready;       // pedido completo à espera de um mundo ocupado
+  int waiting;     // a step deste cliente está no stepper
+  char *out;       // resposta por enviar, NULL quando não há
+  size_t out_len;
+  size_t out_done;
+}conn;
+
+/* A step handed to the stepping thread, answered to client once done */
+typedef struct step_job_ {
+  sim *s;
+  uint32_t world;
+  int n;
+  int done;
+  unsigned long client;
+  struct step_job_ *next;
+}step_job;
+
+/* The stepping thread: a FIFO of steps to run and a list of finished ones */
+typedef struct stepper_ {
+  pthread_t thread;
+  pthread_mutex_t lock;
+  pthread_cond_t ready;
+  step_job *todo;
+  step_job *todo_tail;
+  step_job *done;
+  int wake[2];
+  int threads;
+  int stop;
+}stepper;
+
+static sim **worlds;
+// busy[i]: steps do mundo i + 1 ainda por acabar
+static int *busy;
+static int n_worlds;
+static stepper steps;
+static unsigned long next_conn_id;
+static volatile sig_atomic_t stopping;
+
+static int read_full(int fd, void *buf, size_t n) {
+  char *p = (char *)buf;
+  while(n > 0) {
+    ssize_t k = read(fd, p, n);
+    if(k < 0 && errno == EINTR)
+      continue;
+    if(k <= 0)
+      return -1;
+    p += k;
+    n -= k;
+  }
+  return 0;
+}
+
+static int write_full(int fd, const void *buf, size_t n) {
+  const char *p = (const char *)buf;
+  while(n > 0) {
+    ssize_t k = write(fd, p, n);
+    if(k < 0 && errno == EINTR)
+      continue;
+    if(k <= 0)
+      return -1;
+    p += k;
+    n -= k;
+  }
+  return 0;
+}
+
+static void reply_error(conn *c, const char *msg);
+
+/* Queues the reply; the poll loop sends it as the client reads */
+static void reply(conn *c, int status, const void *payload, size_t len) {
+  response_header h;
+  if(len > MAX_PAYLOAD) {
+    reply_error(c, "reply larger than the maximum payload, use region");
+    return;
+  }
+  h.status = status;
+  h.len = len;
+  c->out = (char *)malloc(sizeof(h) + len);
+  memcpy(c->out, &h, sizeof(h));
+  if(len)
+    memcpy(c->out + sizeof(h), payload, len);
+  c->out_len = sizeof(h) + len;
+  c->out_done = 0;
+}
+
+static void reply_error(conn *c, const char *msg) {
+  reply(c, -1, msg, strlen(msg));
+}
+
+static sim *get_world(uint32_t id) {
+  if(id == 0 || id > (uint32_t)n_worlds)
+    return NULL;
+  return worlds[id - 1];
+}
+
+/* Keeps a world resident and returns its id */
+static uint32_t add_world(sim *s) {
+  int i;
+  for(i = 0; i < n_worlds; i++)
+    if(!worlds[i])
+      break;
+  if(i == n_worlds) {
+    n_worlds++;
+    worlds = (sim **)realloc(worlds, n_worlds * sizeof(sim *));
+    busy = (int *)realloc(busy, n_worlds * sizeof(int));
+  }
+  worlds[i] = s;
+  busy[i] = 0;
+  return i + 1;
+}
+
+static void drop_world(uint32_t id) {
+  sim *s = get_world(id);
+  if(!s)
+    return;
+  sim_end(s);
+  free_world(s);
+  free(s);
+  worlds[id - 1] = NULL;
+}
+
+/* Stepping thread: runs the queued steps a slice at a time, round robin, so a
+   short step is not stuck behind a long one and a shutdown waits for one slice
+   at most. Wakes the poll loop after each step it finishes */
+static void *stepper_main(void *arg) {
+  (void)arg;
+  // O nº de threads escolhido no main não passa para threads criadas com pthreads
+  omp_set_num_threads(steps.threads);
+  for(;;) {
+    step_job *j;
+    int k;
+    char byte = 1;
+    pthread_mutex_lock(&steps.lock);
+    while(!steps.todo && !steps.stop)
+      pthread_cond_wait(&steps.ready, &steps.lock);
+    if(steps.stop) {
+      pthread_mutex_unlock(&steps.lock);
+      break;
+    }
+    j = steps.todo;
+    steps.todo = j->next;
+    j->next = NULL;
+    pthread_mutex_unlock(&steps.lock);
+
+    k = j->n - j->done < STEP_SLICE ? j->n - j->done : STEP_SLICE;
+    sim_run(j->s, k);
+    j->done += k;
+
+    pthread_mutex_lock(&steps.lock);
+    if(j->done < j->n) {
+      // Volta para o fim da fila
+      if(steps.todo)
+        steps.todo_tail->next = j;
+      else
+        steps.todo = j;
+      steps.todo_tail = j;
+      pthread_mutex_unlock(&steps.lock);
+      continue;
+    }
+    j->next = steps.done;
+    steps.done = j;
+    pthread_mutex_unlock(&steps.lock);
+    while(write(steps.wake[1], &byte, 1) < 0 && errno == EINTR)
+      ;
+  }
+  return NULL;
+}
+
+/* Queues a step of world id for client c, which gets its reply once it is done */
+static void queue_step(conn *c, uint32_t id, int n) {
+  step_job *j = (step_job *)calloc(1, sizeof(step_job));
+  j->s = get_world(id);
+  j->world = id;
+  j->n = n;
+  j->client = c->id;
+  busy[id - 1]++;
+  c->waiting = 1;
+  pthread_mutex_lock(&steps.lock);
+  if(steps.todo)
+    steps.todo_tail->next = j;
+  else
+    steps.todo = j;
+  steps.todo_tail = j;
+  pthread_cond_signal(&steps.ready);
+  pthread_mutex_unlock(&steps.lock);
+}
+
+static sim *load_world(const char *text, size_t len, const backend *b) {
+  FILE *in = fmemopen((void *)text, len, "r");
+  sim *s;
+  if(!in)
+    return NULL;
+  s = (sim *)calloc(1, sizeof(sim));
+  if(read_header(s, in) != 0) {
+    fclose(in);
+    free(s);
+    return NULL;
+  }
+  alloc_world(s);
+  init_world(s);
+  if(fill_world(s, in) != 0) {
+    fclose(in);
+    free_world(s);
+    free(s);
+    return NULL;
+  }
+  fclose(in);
+  sim_start(s, b);
+  return s;
+}
+
+/* Serves the complete request buffered in c and queues its reply; a step is
+   queued to the stepping thread instead, which answers it later */
+static void handle_request(conn *c, const backend *b) {
+  request_header h = c->h;
+  char *payload = c->payload;
+  sim *s = get_world(h.world);
+
+  if(h.op != OP_LOAD && !s) {
+    reply_error(c, "no such world");
+    return;
+  }
+
+  switch(h.op) {
+  case OP_LOAD: {
+    sim *n = load_world(payload, h.len, b);
+    uint32_t id;
+    if(!n) {
+      reply_error(c, "invalid input");
+      break;
+    }
+    id = add_world(n);
+    reply(c, 0, &id, sizeof(id));
+    break;
+  }
+  case OP_STEP: {
+    int32_t n;
+    if(h.len != sizeof(n)) {
+      reply_error(c, "bad step");
+      break;
+    }
+    memcpy(&n, payload, sizeof(n));
+    if(n > 0) {
+      queue_step(c, h.world, n);
+      break;
+    }
+    n = s->current_gen;
+    reply(c, 0, &n, sizeof(n));
+    break;
+  }
+  case OP_SNAPSHOT: {
+    size_t len = 3 * sizeof(int32_t) + (size_t)s->R * s->C;
+    char *out;
+    int32_t dims[3] = {s->current_gen, s->R, s->C};
+    int x, y;
+    if(len > MAX_PAYLOAD) {
+      reply_error(c, "world larger than the maximum payload, use region");
+      break;
+    }
+    out = (char *)malloc(len);
+    memcpy(out, dims, sizeof(dims));
+    for(x = 0; x < s->R; x++)
+      for(y = 0; y < s->C; y++)
+        out[sizeof(dims) + (size_t)x * s->C + y] = CELL(s, s->world, x, y).type;
+    reply(c, 0, out, len);
+    free(out);
+    break;
+  }
+  case OP_FORK: {
+    sim *n = (sim *)calloc(1, sizeof(sim));
+    uint32_t id;
+    clone_world(n, s);
+    sim_start(n, s->backend);
+    id = add_world(n);
+    reply(c, 0, &id, sizeof(id));
+    break;
+  }
+  case OP_REGION: {
+    int32_t r[4];
+    char *out;
+    int x, y, k = 0;
+    if(h.len != sizeof(r)) {
+      reply_error(c, "bad region");
+      break;
+    }
+    memcpy(r, payload, sizeof(r));
+    if(r[0] < 0 || r[1] < 0 || r[2] > s->R || r[3] > s->C || r[0] >= r[2] || r[1] >= r[3]) {
+      reply_error(c, "region outside the world");
+      break;
+    }
+    if((size_t)(r[2] - r[0]) * (r[3] - r[1]) > MAX_PAYLOAD) {
+      reply_error(c, "region larger than the maximum payload");
+      break;
+    }
+    out = (char *)malloc((size_t)(r[2] - r[0]) * (r[3] - r[1]));
+    for(x = r[0]; x < r[2]; x++)
+      for(y = r[1]; y < r[3]; y++)
+        out[k++] = CELL(s, s->world, x, y).type;
+    reply(c, 0, out, k);
+    free(out);
+    break;
+  }
+  case OP_COUNTS: {
+    int32_t n[4] = {s->current_gen, 0, 0, 0};
+    int rabbits = 0, foxes = 0, rocks = 0, x, y;
+    // Sem equipa OpenMP aqui: as threads estão com o stepper
+    for(x = 0; x < s->R; x++)
+      for(y = 0; y < s->C; y++) {
+        rabbits += CELL(s, s->world, x, y).type == 'R';
+        foxes += CELL(s, s->world, x, y).type == 'F';
+        rocks += CELL(s, s->world, x, y).type == '*';
+      }
+    n[1] = rabbits;
+    n[2] = foxes;
+    n[3] = rocks;
+    reply(c, 0, n, sizeof(n));
+    break;
+  }
+  case OP_FREE:
+    drop_world(h.world);
+    reply(c, 0, NULL, 0);
+    break;
+  default:
+    reply_error(c, "unknown op");
+  }
+}
+
+/* Reads whatever part of the current request has arrived. Returns 1 once it is
+   complete, 0 if more is needed and -1 when the client is gone or misbehaves */
+static int receive(conn *c) {
+  for(;;) {
+    size_t want;
+    char *dst;
+    ssize_t k;
+    if(c->have < sizeof(c->h)) {
+      want = sizeof(c->h) - c->have;
+      dst = (char *)&c->h + c->have;
+    }
+    else {
+      if(c->have == sizeof(c->h)) {
+        if(c->h.len > MAX_PAYLOAD)
+          return -1;
+        if(c->h.len && !c->payload)
+          c->payload = (char *)malloc(c->h.len);
+      }
+      want = sizeof(c->h) + c->h.len - c->have;
+      dst = c->payload + (c->have - sizeof(c->h));
+    }
+    if(want == 0)
+      return 1;
+    k = read(c->fd, dst, want);
+    if(k < 0 && errno == EINTR)
+      continue;
+    if(k < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+      return 0;
+    if(k <= 0)
+      return -1;
+    c->have += k;
+  }
+}
+
+/* Sends as much of the pending reply as the socket takes; -1 if the client is gone */
+static int flush(conn *c) {
+  while(c->out_done < c->out_len) {
+    ssize_t k = write(c->fd, c->out + c->out_done, c->out_len - c->out_done);
+    if(k < 0 && errno == EINTR)
+      continue;
+    if(k < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+      return 0;
+    if(k <= 0)
+      return -1;
+    c->out_done += k;
+  }
+  free(c->out);
+  c->out = NULL;
+  return 0;
+}
+
+static void close_conn(conn *c) {
+  close(c->fd);
+  free(c->payload);
+  free(c->out);
+}
+
+/* Serves the request c has buffered unless its world has a step pending, in
+   which case it stays buffered until the step is done */
+static int dispatch(conn *c, const backend *b) {
+  if(c->h.op != OP_LOAD && c->h.world >= 1 && c->h.world <= (uint32_t)n_worlds &&
+     busy[c->h.world - 1]) {
+    c->ready = 1;
+    return 0;
+  }
+  c->ready = 0;
+  handle_request(c, b);
+  free(c->payload);
+  c->payload = NULL;
+  c->have = 0;
+  if(!c->out)
+    return 0;
+  // Na maioria das vezes a resposta cabe no socket e sai já
+  return flush(c);
+}
+
+/* Handles the poll events of one client, returns -1 when it must be dropped */
+static int serve_conn(conn *c, short revents, const backend *b) {
+  int r;
+  if(revents & (POLLERR | POLLNVAL))
+    return -1;
+  if(c->out) {
+    if(!(revents & (POLLOUT | POLLHUP)))
+      return 0;
+    return flush(c);
+  }
+  // À espera de um mundo ocupado só interessa saber se o cliente desligou
+  if(c->ready || c->waiting)
+    return revents & POLLHUP ? -1 : 0;
+  if(!(revents & (POLLIN | POLLHUP)))
+    return 0;
+  r = receive(c);
+  if(r <= 0)
+    return r;
+  return dispatch(c, b);
+}
+
+/* Answers the steps the stepping thread finished, marking in drop[] the clients
+   the reply could not be sent to */
+static void finish_steps(conn *conns, int n_fds, char *drop) {
+  step_job *j;
+  char buf[64];
+  int i;
+  while(read(steps.wake[0], buf, sizeof(buf)) > 0)
+    ;
+  pthread_mutex_lock(&steps.lock);
+  j = steps.done;
+  steps.done = NULL;
+  pthread_mutex_unlock(&steps.lock);
+  while(j) {
+    step_job *next = j->next;
+    busy[j->world - 1]--;
+    for(i = FIRST_CLIENT; i < n_fds; i++)
+      if(conns[i].id == j->client && conns[i].waiting) {
+        int32_t gen = j->s->current_gen;
+        conns[i].waiting = 0;
+        reply(&conns[i], 0, &gen, sizeof(gen));
+        if(flush(&conns[i]) != 0)
+          drop[i] = 1;
+        break;
+      }
+    free(j);
+    j = next;
+  }
+}
+
+static void on_signal(int sig) {
+  (void)sig;
+  stopping = 1;
+}
+
+/* Runs the daemon on a Unix domain socket until SIGINT or SIGTERM */
+int serve(const char *path, const backend *b) {
+  struct sockaddr_un addr;
+  struct pollfd fds[MAX_CLIENTS + FIRST_CLIENT];
+  // conns[i] é o cliente de fds[i], a partir de FIRST_CLIENT
+  conn conns[MAX_CLIENTS + FIRST_CLIENT];
+  char drop[MAX_CLIENTS + FIRST_CLIENT];
+  int n_fds = FIRST_CLIENT, i;
+  int lfd = socket(AF_UNIX, SOCK_STREAM, 0);
+
+  if(lfd < 0 || strlen(path) >= sizeof(addr.sun_path)) {
+    fprintf(stderr, "server: cannot use socket '%s'\n", path);
+    return 1;
+  }
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  strcpy(addr.sun_path, path);
+  unlink(path);
+  if(bind(lfd, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(lfd, 16) != 0) {
+    perror(path);
+    close(lfd);
+    return 1;
+  }
+  if(pipe(steps.wake) != 0 || fcntl(steps.wake[0], F_SETFL, O_NONBLOCK) != 0) {
+    perror("pipe");
+    close(lfd);
+    return 1;
+  }
+  signal(SIGPIPE, SIG_IGN);
+  signal(SIGINT, on_signal);
+  signal(SIGTERM, on_signal);
+  steps.threads = omp_get_max_threads();
+  pthread_mutex_init(&steps.lock, NULL);
+  pthread_cond_init(&steps.ready, NULL);
+  pthread_create(&steps.thread, NULL, stepper_main, NULL);
+  fprintf(stderr, "server: listening on %s (backend %s, %d threads)\n",
+          path, b->name, steps.threads);
+
+  fds[0].fd = lfd;
+  fds[0].events = POLLIN;
+  fds[1].fd = steps.wake[0];
+  fds[1].events = POLLIN;
+  while(!stopping) {
+    if(poll(fds, n_fds, -1) < 0) {
+      if(errno == EINTR)
+        continue;
+      break;
+    }
+    memset(drop, 0, sizeof(drop));
+    for(i = FIRST_CLIENT; i < n_fds; i++)
+      if(fds[i].revents && serve_conn(&conns[i], fds[i].revents, b) != 0)
+        drop[i] = 1;
+    if(fds[1].revents & POLLIN) {
+      finish_steps(conns, n_fds, drop);
+      // Os pedidos que esperavam por um mundo que ficou livre seguem agora
+      for(i = FIRST_CLIENT; i < n_fds; i++)
+        if(!drop[i] && conns[i].ready && dispatch(&conns[i], b) != 0)
+          drop[i] = 1;
+    }
+    for(i = n_fds - 1; i >= FIRST_CLIENT; i--) {
+      if(drop[i]) {
+        close_conn(&conns[i]);
+        n_fds--;
+        fds[i] = fds[n_fds];
+        conns[i] = conns[n_fds];
+      }
+    }
+    if(fds[0].revents & POLLIN) {
+      int cfd = accept(lfd, NULL, NULL);
+      if(cfd >= 0 && (n_fds == MAX_CLIENTS + FIRST_CLIENT || fcntl(cfd, F_SETFL, O_NONBLOCK) != 0))
+        close(cfd);
+      else if(cfd >= 0) {
+        memset(&conns[n_fds], 0, sizeof(conn));
+        conns[n_fds].fd = cfd;
+        conns[n_fds].id = ++next_conn_id;
+        fds[n_fds].fd = cfd;
+        n_fds++;
+      }
+    }
+    // Um cliente com resposta pendente só é lido depois de a receber toda, e um
+    // que espera pelo stepper não é lido de todo
+    for(i = FIRST_CLIENT; i < n_fds; i++) {
+      fds[i].events = conns[i].out ? POLLOUT : conns[i].ready || conns[i].waiting ? 0 : POLLIN;
+      fds[i].revents = 0;
+    }
+    fds[0].revents = fds[1].revents = 0;
+  }
+
+  // O stepper acaba a fatia em curso e deixa o resto das steps por correr
+  pthread_mutex_lock(&steps.lock);
+  steps.stop = 1;
+  pthread_cond_signal(&steps.ready);
+  pthread_mutex_unlock(&steps.lock);
+  pthread_join(steps.thread, NULL);
+  pthread_mutex_destroy(&steps.lock);
+  pthread_cond_destroy(&steps.ready);
+  while(steps.todo) {
+    step_job *j = steps.todo;
+    steps.todo = j->next;
+    free(j);
+  }
+  while(steps.done) {
+    step_job *j = steps.done;
+    steps.done = j->next;
+    free(j);
+  }
+  close(steps.wake[0]);
+  close(steps.wake[1]);
+
+  for(i = FIRST_CLIENT; i < n_fds; i++)
+    close_conn(&conns[i]);
+  close(lfd);
+  unlink(path);
+  for(i = 1; i <= n_worlds; i++)
+    drop_world(i);
+  free(worlds);
+  free(busy);
+  return 0;
+}
+
+/* Sends one request and waits for the reply; the reply payload is malloc'd */
+static int call(int fd, uint32_t op, uint32_t world, const void *payload, uint32_t len,
+                char **out, uint32_t *out_len) {
+  request_header h;
+  response_header r;
+  h.op = op;
+  h.world = world;
+  h.len = len;
+  if(write_full(fd, &h, sizeof(h)) != 0 || write_full(fd, payload, len) != 0)
+    return -2;
+  if(read_full(fd, &r, sizeof(r)) != 0 || r.len > MAX_PAYLOAD)
+    return -2;
+  *out = (char *)malloc(r.len + 1);
+  if(read_full(fd, *out, r.len) != 0) {
+    free(*out);
+    return -2;
+  }
+  (*out)[r.len] = '\0';
+  *out_len = r.len;
+  return r.status;
+}
+
+static void print_rows(const char *cells, int rows, int cols) {
+  int x;
+  for(x = 0; x < rows; x++)
+    printf("|%.*s|\n", cols, cells + (size_t)x * cols);
+}
+
+/* Scripted client, reads one command per line from stdin:
+     load FILE | step W N | snapshot W | fork W | region W X0 Y0 X1 Y1 | counts W | free W
+   Prints the replies on stdout and the round-trip time of each request on stderr */
+int client(const char *path) {
+  struct sockaddr_un addr;
+  char line[4096], cmd[16], arg[4096];
+  int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+
+  if(fd < 0 || strlen(path) >= sizeof(addr.sun_path))
+    return 1;
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  strcpy(addr.sun_path, path);
+  if(connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+    perror(path);
+    close(fd);
+    return 1;
+  }
+
+  while(fgets(line, sizeof(line), stdin)) {
+    char *out = NULL, *payload = NULL;
+    uint32_t out_len = 0, len = 0, op, world = 0;
+    int32_t args[4];
+    int status;
+    double start;
+
+    if(sscanf(line, "%15s", cmd) != 1 || cmd[0] == '#')
+      continue;
+    if(strcmp(cmd, "load") == 0) {
+      FILE *f;
+      long size;
+      if(sscanf(line, "%*s %4095s", arg) != 1 || !(f = fopen(arg, "rb"))) {
+        fprintf(stderr, "cannot read input for: %s", line);
+        continue;
+      }
+      fseek(f, 0, SEEK_END);
+      size = ftell(f);
+      fseek(f, 0, SEEK_SET);
+      payload = (char *)malloc(size);
+      len = fread(payload, 1, size, f);
+      fclose(f);
+      op = OP_LOAD;
+    }
+    else if(strcmp(cmd, "step") == 0 && sscanf(line, "%*s %u %d", &world, &args[0]) == 2) {
+      op = OP_STEP;
+      payload = (char *)args;
+      len = sizeof(int32_t);
+    }
+    else if(strcmp(cmd, "region") == 0 &&
+            sscanf(line, "%*s %u %d %d %d %d", &world, &args[0], &args[1], &args[2], &args[3]) == 5) {
+      op = OP_REGION;
+      payload = (char *)args;
+      len = sizeof(args);
+    }
+    else if(strcmp(cmd, "snapshot") == 0 && sscanf(line, "%*s %u", &world) == 1)
+      op = OP_SNAPSHOT;
+    else if(strcmp(cmd, "fork") == 0 && sscanf(line, "%*s %u", &world) == 1)
+      op = OP_FORK;
+    else if(strcmp(cmd, "counts") == 0 && sscanf(line, "%*s %u", &world) == 1)
+      op = OP_COUNTS;
+    else if(strcmp(cmd, "free") == 0 && sscanf(line, "%*s %u", &world) == 1)
+      op = OP_FREE;
+    else {
+      fprintf(stderr, "bad command: %s", line);
+      continue;
+    }
+
+    start = omp_get_wtime();
+    status = call(fd, op, world, payload, len, &out, &out_len);
+    fprintf(stderr, "%s: %.1f us\n", cmd, (omp_get_wtime() - start) * 1e6);
+    if(op == OP_LOAD)
+      free(payload);
+    if(status == -2) {
+      fprintf(stderr, "server closed the connection\n");
+      break;
+    }
+    if(status != 0)
+      printf("error: %s\n", out);
+    else if(op == OP_LOAD || op == OP_FORK)
+      printf("world %u\n", *(uint32_t *)out);
+    else if(op == OP_STEP)
+      printf("gen %d\n", *(int32_t *)out);
+    else if(op == OP_COUNTS) {
+      int32_t *c = (int32_t *)out;
+      printf("gen %d rabbits %d foxes %d rocks %d\n", c[0], c[1], c[2], c[3]);
+    }
+    else if(op == OP_SNAPSHOT) {
+      int32_t *d = (int32_t *)out;
+      printf("Generation %d\n", d[0]);
+      print_rows(out + 3 * sizeof(int32_t), d[1], d[2]);
+    }
+    else if(op == OP_REGION)
+      print_rows(out, args[2] - args[0], args[3] - args[1]);
+    else
+      printf("ok\n");
+    free(out);
+  }
+  close(fd);
+  return 0;
+}
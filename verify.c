@@ -0,0 +1,60 @@
+#include<stdio.h>
+#include "ecosystem.h"
+
+/* Reports the first cell (row-major) where the candidate differs from the reference */
+static void report_divergence(const sim *ref, const sim *cand, int gen, const char *where) {
+  int x,y;
+  for(x = 0; x < ref->R; x++) {
+    for(y = 0; y < ref->C; y++) {
+      const object *a = &CELL(ref, ref->world, x, y), *b = &CELL(cand, cand->world, x, y);
+      if(a->type != b->type ||
+         ((a->type == 'R' || a->type == 'F') && a->num_gen != b->num_gen) ||
+         (a->type == 'F' && a->num_food != b->num_food)) {
+        fprintf(stderr,
+                "verify: %s diverges from %s at generation %d (%s), cell %d %d: "
+                "expected '%c' gen %d food %d, got '%c' gen %d food %d\n",
+                cand->backend->name, ref->backend->name, gen, where, x, y,
+                a->type, a->num_gen, a->num_food, b->type, b->num_gen, b->num_food);
+        return;
+      }
+    }
+  }
+  fprintf(stderr, "verify: %s diverges from %s at generation %d (%s)\n",
+          cand->backend->name, ref->backend->name, gen, where);
+}
+
+/* Runs two backends in lockstep and compares their grids after every phase,
+   or after every generation when one of them does not expose its phases.
+   Returns 0 if they agree for all generations, 1 at the first divergence. */
+int verify(sim *ref, sim *cand) {
+  int phases = ref->backend->rabbit_phase && cand->backend->rabbit_phase;
+  while(ref->current_gen < ref->n_gen) {
+    int gen = ref->current_gen;
+    if(!phases) {
+      sim_step(ref);
+      sim_step(cand);
+      if(world_hash(ref) != world_hash(cand)) {
+        report_divergence(ref, cand, gen, "end of generation");
+        return 1;
+      }
+      continue;
+    }
+    ref->backend->rabbit_phase(ref);
+    cand->backend->rabbit_phase(cand);
+    if(world_hash(ref) != world_hash(cand)) {
+      report_divergence(ref, cand, gen, "rabbit phase");
+      return 1;
+    }
+    ref->backend->fox_phase(ref);
+    cand->backend->fox_phase(cand);
+    if(world_hash(ref) != world_hash(cand)) {
+      report_divergence(ref, cand, gen, "fox phase");
+      return 1;
+    }
+    end_generation(ref);
+    end_generation(cand);
+  }
+  fprintf(stderr, "verify: %s matches %s for %d generations\n",
+          cand->backend->name, ref->backend->name, ref->n_gen);
+  return 0;
+}
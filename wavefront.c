@@ -0,0 +1,116 @@
+#include<stdio.h>
+#include<stdlib.h>
+#include<omp.h>
+#include "ecosystem.h"
+
+/* Dataflow backend: every generation is split into blocks of whole bands and each
+   block goes through four tasks, ordered only by the blocks it shares rows with.
+   With A the world at the start of a generation and B the new world:
+     R(b)  copy foxes and move rabbits of block b      reads A b-1..b+1, writes B b-1..b+1
+     P(b)  reset A and copy the rabbits back, block b  after R(b-1..b+1)
+     F(b)  move foxes of block b                       reads B b-1..b+1, writes A b-1..b+1
+     Z(b)  reset B, block b                            after F(b-1..b+1)
+   R(b) of the next generation only waits for Z(b-1..b+1), so early blocks of the
+   next generation run while later blocks of the current one are still moving.
+   Two swaps per generation leave A as the world, so no pointers change hands. */
+
+// Mínimo de linhas por bloco, igual ao chunk do schedule(dynamic, 4) do omp-locks;
+// arredondado para bandas inteiras no layout em tiles
+#define WAVEFRONT_ROWS 4
+// Blocos por thread: chega para esconder o desequilíbrio sem pagar tarefas a mais
+#define WAVEFRONT_BLOCKS_PER_THREAD 4
+// Gerações submetidas antes de esperar, limita o número de tarefas pendentes
+#define WAVEFRONT_WINDOW 16
+
+/* The blocks are whole bands, so each block function walks whole slots t0..t1-1 */
+static void rabbit_block(sim *s, object **a, object **b, int gen, int t0, int t1) {
+  worker *w = &s->workers[omp_get_thread_num()];
+  int t;
+  for(t = t0; t < t1; t++)
+    move_slot(s, w, a, b, gen, t, 'R');
+}
+
+static void prep_block(sim *s, object **a, object **b, int t0, int t1) {
+  int t;
+  for(t = t0; t < t1; t++)
+    carry_rabbits(s, b, a, t);
+}
+
+static void fox_block(sim *s, object **a, object **b, int gen, int t0, int t1) {
+  worker *w = &s->workers[omp_get_thread_num()];
+  int t;
+  for(t = t0; t < t1; t++)
+    move_slot(s, w, b, a, gen, t, 'F');
+}
+
+static void clear_block(sim *s, object **b, int t0, int t1) {
+  int t;
+  for(t = t0; t < t1; t++)
+    clear_slot(s, b, t);
+}
+
+/* Advances n generations as one task graph */
+static void run(sim *s, int n) {
+  object **a = s->world, **b = s->new_world;
+  int bands = s->n_bands / (WAVEFRONT_BLOCKS_PER_THREAD * omp_get_max_threads());
+  if(bands * BAND_ROWS < WAVEFRONT_ROWS)
+    bands = (WAVEFRONT_ROWS + BAND_ROWS - 1) / BAND_ROWS;
+  int nb = (s->n_bands + bands - 1) / bands;
+  int span = bands * s->band_slots;
+  int first = s->current_gen;
+  // Um token por bloco e por tarefa, com uma sentinela de cada lado: o bloco k usa [k + 1]
+  char *r_tok = (char *)calloc(nb + 2, 1);
+  char *p_tok = (char *)calloc(nb + 2, 1);
+  char *f_tok = (char *)calloc(nb + 2, 1);
+  char *z_tok = (char *)calloc(nb + 2, 1);
+
+  #pragma omp parallel
+  #pragma omp single
+  {
+    int g, k;
+    for(g = first; g < first + n; g++) {
+      for(k = 0; k < nb; k++) {
+        int t0 = k * span, t1 = t0 + span < s->n_slots ? t0 + span : s->n_slots;
+        #pragma omp task firstprivate(g, t0, t1) \
+          depend(in: z_tok[k], z_tok[k + 1], z_tok[k + 2]) depend(out: r_tok[k + 1])
+        rabbit_block(s, a, b, g, t0, t1);
+      }
+      for(k = 0; k < nb; k++) {
+        int t0 = k * span, t1 = t0 + span < s->n_slots ? t0 + span : s->n_slots;
+        #pragma omp task firstprivate(t0, t1) \
+          depend(in: r_tok[k], r_tok[k + 1], r_tok[k + 2]) depend(out: p_tok[k + 1])
+        prep_block(s, a, b, t0, t1);
+      }
+      for(k = 0; k < nb; k++) {
+        int t0 = k * span, t1 = t0 + span < s->n_slots ? t0 + span : s->n_slots;
+        #pragma omp task firstprivate(g, t0, t1) \
+          depend(in: p_tok[k], p_tok[k + 1], p_tok[k + 2]) depend(out: f_tok[k + 1])
+        fox_block(s, a, b, g, t0, t1);
+      }
+      for(k = 0; k < nb; k++) {
+        int t0 = k * span, t1 = t0 + span < s->n_slots ? t0 + span : s->n_slots;
+        #pragma omp task firstprivate(t0, t1) \
+          depend(in: f_tok[k], f_tok[k + 1], f_tok[k + 2]) depend(out: z_tok[k + 1])
+        clear_block(s, b, t0, t1);
+      }
+      if((g - first + 1) % WAVEFRONT_WINDOW == 0) {
+        #pragma omp taskwait
+      }
+    }
+  }
+
+  free(r_tok);
+  free(p_tok);
+  free(f_tok);
+  free(z_tok);
+}
+
+const backend wavefront_backend = {
+  "wavefront",
+  init_locks,
+  destroy_locks,
+  NULL,
+  NULL,
+  run,
+  0,
+};
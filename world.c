@@ -0,0 +1,458 @@
+#include<stdio.h>
+#include<stdlib.h>
+#include<string.h>
+#include<omp.h>
+#include "ecosystem.h"
+
+static const backend *backends[] = {
+  &sequential_backend,
+  &omp_locks_backend,
+  &wavefront_backend,
+  &inplace_backend,
+};
+
+/* Looks up a backend by name, returns NULL if there is none */
+const backend *find_backend(const char *name) {
+  size_t i;
+  for(i = 0; i < sizeof(backends) / sizeof(backends[0]); i++) {
+    if(strcmp(backends[i]->name, name) == 0)
+      return backends[i];
+  }
+  return NULL;
+}
+
+/* Reads the seven header values of an input file */
+int read_header(sim *s, FILE *in) {
+  if(fscanf(in, "%d %d %d %d %d %d %d",
+            &s->gen_proc_rabbits,
+            &s->gen_proc_foxes,
+            &s->gen_food_foxes,
+            &s->n_gen,
+            &s->R,
+            &s->C,
+            &s->N) != 7)
+    return -1;
+  if(s->R <= 0 || s->C <= 0 || s->N < 0 || s->n_gen < 0)
+    return -1;
+  s->current_gen = 0;
+  return 0;
+}
+
+#ifdef LAYOUT_TILED
+/* Interleaves the bits of a tile's row and column: its position on the Z-order curve */
+static unsigned long long morton(unsigned int tx, unsigned int ty) {
+  unsigned long long code = 0;
+  int bit;
+  for(bit = 0; bit < 32; bit++) {
+    code |= (unsigned long long)((tx >> bit) & 1) << (2 * bit + 1);
+    code |= (unsigned long long)((ty >> bit) & 1) << (2 * bit);
+  }
+  return code;
+}
+
+typedef struct tile_key_ {
+  unsigned long long code;
+  int slot;
+}tile_key;
+
+static int by_morton(const void *a, const void *b) {
+  const tile_key *ka = (const tile_key *)a, *kb = (const tile_key *)b;
+  return ka->code < kb->code ? -1 : ka->code > kb->code;
+}
+#endif
+
+/* Works out how the grids of this world are cut into slots and in which order
+   the slots are stored */
+static void init_layout(sim *s) {
+  int k;
+#ifdef LAYOUT_TILED
+  s->n_bands = (s->R + TILE - 1) / TILE;
+  s->band_slots = (s->C + TILE - 1) / TILE;
+  s->slot_cells = TILE * TILE;
+#else
+  s->n_bands = s->R;
+  s->band_slots = 1;
+  s->slot_cells = s->C;
+#endif
+  s->n_slots = s->n_bands * s->band_slots;
+  s->slot_order = (int *)malloc(s->n_slots * sizeof(int));
+#ifdef LAYOUT_TILED
+  tile_key *keys = (tile_key *)malloc(s->n_slots * sizeof(tile_key));
+  for(k = 0; k < s->n_slots; k++) {
+    keys[k].code = morton(k / s->band_slots, k % s->band_slots);
+    keys[k].slot = k;
+  }
+  qsort(keys, s->n_slots, sizeof(tile_key), by_morton);
+  for(k = 0; k < s->n_slots; k++)
+    s->slot_order[k] = keys[k].slot;
+  free(keys);
+#else
+  for(k = 0; k < s->n_slots; k++)
+    s->slot_order[k] = k;
+#endif
+}
+
+/* Allocates one grid: the slot table plus a single block holding every slot in
+   slot_order. The block itself is kept after the last table entry. Every cell
+   starts empty, also those of edge tiles that fall outside the world: the slot
+   sweeps walk whole slots and rely on them staying empty */
+object **alloc_grid(const sim *s) {
+  size_t n = (size_t)s->n_slots * s->slot_cells, i;
+  object **g = (object **)malloc(sizeof(object*) * (s->n_slots + 1));
+  object *block = (object *)malloc(n * sizeof(object));
+  int k;
+  for(i = 0; i < n; i++) {
+    block[i].type = ' ';
+    block[i].num_gen = 0;
+    block[i].num_food = 0;
+  }
+  for(k = 0; k < s->n_slots; k++)
+    g[s->slot_order[k]] = block + (size_t)k * s->slot_cells;
+  g[s->n_slots] = block;
+  return g;
+}
+
+void free_grid(const sim *s, object **g) {
+  if(!g)
+    return;
+  free(g[s->n_slots]);
+  free(g);
+}
+
+/* Allocates the world grid; the second grid is left to sim_start() since
+   single-buffer backends never need it */
+void alloc_world(sim *s) {
+  init_layout(s);
+  s->world = alloc_grid(s);
+  s->new_world = NULL;
+}
+
+/* Allocates the new world as it is at the start of every generation: only the rocks */
+static void alloc_new_world(sim *s) {
+  int k;
+  s->new_world = alloc_grid(s);
+  #pragma omp parallel for schedule(static)
+  for(k = 0; k < s->n_slots; k++) {
+    const object *src = s->world[s->slot_order[k]];
+    object *dst = s->new_world[s->slot_order[k]];
+    int i;
+    for(i = 0; i < s->slot_cells; i++) {
+      if(src[i].type == '*')
+        dst[i] = src[i];
+      else {
+        dst[i].type = ' ';
+        dst[i].num_gen = 0;
+        dst[i].num_food = 0;
+      }
+    }
+  }
+}
+
+/* Frees the world grids */
+void free_world(sim *s) {
+  free_grid(s, s->world);
+  free_grid(s, s->new_world);
+  free(s->slot_order);
+  s->world = NULL;
+  s->new_world = NULL;
+  s->slot_order = NULL;
+}
+
+/* Makes dst an independent copy of src: same header, same world, no backend attached */
+void clone_world(sim *dst, const sim *src) {
+  *dst = *src;
+  dst->backend = NULL;
+  dst->cell_locks = NULL;
+  dst->priv = NULL;
+  dst->workers = NULL;
+  dst->stats_out = NULL;
+  dst->recorder = NULL;
+  dst->cache = NULL;
+  dst->profile = NULL;
+  alloc_world(dst);
+  memcpy(dst->world[dst->n_slots], src->world[src->n_slots],
+         (size_t)src->n_slots * src->slot_cells * sizeof(object));
+}
+
+/* Initializes all cells in the world grid as empty spaces */
+void init_world(sim *s){
+  int x,y;
+  #pragma omp parallel for private(y) schedule(static)
+  for(x = 0; x < s->R; x++) {
+    for(y = 0; y < s->C; y++) {
+      object empty;
+      empty.type = ' ';
+      empty.num_gen = 0;
+      empty.num_food = 0;
+      CELL(s, s->world, x, y) = empty;
+    }
+  }
+}
+
+/* Fills the world with initial objects (rabbits, foxes, rocks) from input */
+int fill_world(sim *s, FILE *in){
+  int i, x, y;
+  char name[7];
+  for(i = 0; i < s->N; i++) {
+    if(fscanf(in, "%6s %d %d", name, &x, &y) != 3)
+      return -1;
+    if(x < 0 || x >= s->R || y < 0 || y >= s->C)
+      return -1;
+    object new_addition;
+    new_addition.num_gen = 0;
+    new_addition.num_food = 0;
+    if(strcmp(name, "RABBIT") == 0){
+      new_addition.type='R';
+      new_addition.num_gen=s->gen_proc_rabbits;
+    }else if(strcmp(name, "FOX") == 0){
+      new_addition.type='F';
+      new_addition.num_gen=s->gen_proc_foxes;
+      new_addition.num_food=s->gen_food_foxes;
+    }else if(strcmp(name, "ROCK") == 0){
+      new_addition.type='*';
+    }else
+      return -1;
+    CELL(s, s->world, x, y) = new_addition;
+  }
+  return 0;
+}
+
+/* Swaps the current world with the new world for the next generation */
+void swap_worlds(sim *s) {
+  object **aux;
+  aux = s->world;
+  s->world = s->new_world;
+  s->new_world = aux;
+}
+
+/* Displays the current state of the world grid for the given generation */
+void print_world(const sim *s) {
+  int x,y;
+  printf("Generation %d\n", s->current_gen);
+  for(x = 0; x < s->C + 2; x++)
+    printf("-");
+  printf("\n");
+  for(x = 0; x < s->R; x++) {
+    printf("|");
+    for(y = 0; y < s->C; y++) {
+      printf("%c", CELL(s, s->world, x, y).type);
+    }
+    printf("|");
+    printf("\n");
+  }
+  for(x = 0; x < s->C + 2; x++)
+    printf("-");
+  printf("\n");
+  printf("\n");
+}
+
+/* Outputs the final state of the world with all remaining objects and their positions */
+void output(const sim *s) {
+  int x,y;
+  int n_objects = 0;
+
+  // Conta objetos em paralelo
+  #pragma omp parallel for private(y) reduction(+:n_objects) schedule(static)
+  for(x = 0; x < s->R; x++) {
+    for(y = 0; y < s->C; y++) {
+      if(CELL(s, s->world, x, y).type != ' ')
+        n_objects++;
+    }
+  }
+
+  printf("%d %d %d %d %d %d %d\n",
+         s->gen_proc_rabbits,
+         s->gen_proc_foxes,
+         s->gen_food_foxes,
+         0,
+         s->R,
+         s->C,
+         n_objects);
+
+  for(x = 0; x < s->R; x++) {
+    for(y = 0; y < s->C; y++) {
+      if(CELL(s, s->world, x, y).type == 'R')
+        printf("RABBIT ");
+      else if(CELL(s, s->world, x, y).type == 'F')
+        printf("FOX ");
+      else if(CELL(s, s->world, x, y).type == '*')
+        printf("ROCK ");
+      else
+        continue;
+      printf("%d %d\n", x, y);
+    }
+  }
+}
+
+/* FNV-1a hash of the grid, only over the fields that are meaningful for each cell type */
+unsigned long long world_hash(const sim *s) {
+  unsigned long long h = 1469598103934665603ULL;
+  int x,y;
+  for(x = 0; x < s->R; x++) {
+    for(y = 0; y < s->C; y++) {
+      const object *o = &CELL(s, s->world, x, y);
+      int v[3] = {o->type, 0, 0}, k;
+      if(o->type == 'R' || o->type == 'F')
+        v[1] = o->num_gen;
+      if(o->type == 'F')
+        v[2] = o->num_food;
+      for(k = 0; k < 3; k++) {
+        h ^= (unsigned int)v[k];
+        h *= 1099511628211ULL;
+      }
+    }
+  }
+  return h;
+}
+
+/* Moves every creature of one kind in slot t from one grid to the other. The
+   rabbit step also carries the foxes across, since they stay put while rabbits move */
+void move_slot(sim *s, worker *w, object **from, object **to, int gen, int t, char kind) {
+  const object *src = from[t];
+  object *dst = to[t];
+  int i,x0,x1,y0,y1;
+  slot_bounds(s, t, &x0, &x1, &y0, &y1);
+  // Percorre o slot pela ordem da memória; as células fora do mundo estão vazias
+  for(i = 0; i < s->slot_cells; i++) {
+    if(src[i].type == kind) {
+      if(kind == 'R')
+        move_rabbit(s, w, from, to, gen, x0 + SLOT_X(i), y0 + SLOT_Y(i), t, i);
+      else
+        move_fox(s, w, from, to, gen, x0 + SLOT_X(i), y0 + SLOT_Y(i), t, i);
+    }
+    else if(kind == 'R' && src[i].type == 'F')
+      dst[i] = src[i];
+  }
+}
+
+/* Starts slot t of the grid the foxes move into: the rabbits that survived in
+   from, the rocks already in to, and nothing else */
+void carry_rabbits(sim *s, object **from, object **to, int t) {
+  const object *src = from[t];
+  object *dst = to[t];
+  int i;
+  for(i = 0; i < s->slot_cells; i++) {
+    if(src[i].type == 'R')
+      dst[i] = src[i];
+    else if(dst[i].type != '*') {
+      dst[i].type = ' ';
+      dst[i].num_gen = 0;
+      dst[i].num_food = 0;
+    }
+  }
+}
+
+/* Resets the cells of slot t that don't contain rocks */
+void clear_slot(sim *s, object **g, int t) {
+  object *o = g[t];
+  int i;
+  for(i = 0; i < s->slot_cells; i++) {
+    if(o[i].type != '*') {
+      o[i].type = ' ';
+      o[i].num_gen = 0;
+      o[i].num_food = 0;
+    }
+  }
+}
+
+/* Rabbit half of a generation, leaves the new world holding the surviving rabbits.
+   Slots run in parallel when the backend has the cell locks to resolve concurrent
+   moves (omp-locks), one after the other otherwise (seq) */
+void rabbit_phase(sim *s) {
+  int k, par = s->cell_locks != NULL;
+
+  profile_begin(s);
+  // Schedule dinâmico com chunk size de 4 slots para melhor balanceamento
+  #pragma omp parallel if(par)
+  {
+    worker *w = &s->workers[omp_get_thread_num()];
+    #pragma omp for schedule(dynamic, 4)
+    for(k = 0; k < s->n_slots; k++)
+      move_slot(s, w, s->world, s->new_world, s->current_gen, s->slot_order[k], 'R');
+  }
+  profile_end(s, PHASE_RABBIT_MOVE);
+  profile_begin(s);
+  swap_worlds(s);
+  #pragma omp parallel for if(par) schedule(static)
+  for(k = 0; k < s->n_slots; k++)
+    carry_rabbits(s, s->world, s->new_world, s->slot_order[k]);
+  profile_end(s, PHASE_RABBIT_CARRY);
+}
+
+/* Fox half of a generation */
+void fox_phase(sim *s) {
+  int k, par = s->cell_locks != NULL;
+
+  profile_begin(s);
+  #pragma omp parallel if(par)
+  {
+    worker *w = &s->workers[omp_get_thread_num()];
+    #pragma omp for schedule(dynamic, 4)
+    for(k = 0; k < s->n_slots; k++)
+      move_slot(s, w, s->world, s->new_world, s->current_gen, s->slot_order[k], 'F');
+  }
+  profile_end(s, PHASE_FOX_MOVE);
+  profile_begin(s);
+  swap_worlds(s);
+  #pragma omp parallel for if(par) schedule(static)
+  for(k = 0; k < s->n_slots; k++)
+    clear_slot(s, s->new_world, s->slot_order[k]);
+  profile_end(s, PHASE_FOX_RESET);
+}
+
+/* Attaches a backend to an already filled world */
+void sim_start(sim *s, const backend *b) {
+  s->backend = b;
+  s->cell_locks = NULL;
+  s->priv = NULL;
+  if(!b->single_buffer && !s->new_world)
+    alloc_new_world(s);
+  alloc_workers(s);
+  if(b->init)
+    b->init(s);
+}
+
+/* Advances the world by one generation: rabbits move first, then foxes. The
+   phases mark their own parts of the profile */
+void sim_step(sim *s) {
+  if(s->backend->rabbit_phase) {
+    s->backend->rabbit_phase(s);
+    s->backend->fox_phase(s);
+  }
+  else {
+    profile_begin(s);
+    s->backend->run(s, 1);
+    profile_end(s, PHASE_RUN);
+  }
+  profile_begin(s);
+  end_generation(s);
+  profile_end(s, PHASE_REDUCE);
+  if(s->recorder) {
+    profile_begin(s);
+    record_generation(s);
+    profile_end(s, PHASE_RECORD);
+  }
+}
+
+/* Advances the world by n generations. Backends that overlap generations get
+   them all at once unless something needs to observe every generation */
+void sim_run(sim *s, int n) {
+  if(s->backend->run && !s->stats_out && !s->recorder) {
+    profile_begin(s);
+    s->backend->run(s, n);
+    profile_end(s, PHASE_RUN);
+    clear_workers(s);
+    s->current_gen += n;
+    return;
+  }
+  while(n-- > 0)
+    sim_step(s);
+}
+
+/* Releases whatever the backend allocated */
+void sim_end(sim *s) {
+  if(s->backend && s->backend->destroy)
+    s->backend->destroy(s);
+  s->backend = NULL;
+  free_workers(s);
+}